@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "omp.h"
+
+#include "functors.hpp"
+#include "VectorDistribution.hpp"
+#include "Benchmark.hpp"
+#include "Utils.hpp"
+
+/**
+ * \brief Struct BenchmarkConfig holds the command line options of the benchmark.
+ */
+struct BenchmarkConfig {
+    std::vector<GlobalIndex> sizes{1 << 20};
+    std::vector<int> threads{1};
+    std::vector<std::string> skeletons; // empty: all
+    std::vector<std::string> types; // empty: all
+    bool weak = false; // sizes are per process
+};
+
+template <typename T>
+std::vector<T> parseList(const std::string& list) {
+    std::vector<T> values;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        std::stringstream itemStream(item);
+        T value;
+        itemStream >> value;
+        values.push_back(value);
+    }
+    return values;
+}
+
+bool selected(const std::vector<std::string>& filter, const std::string& name) {
+    return filter.empty() || std::find(filter.begin(), filter.end(), name) != filter.end();
+}
+
+/**
+ * \brief Runs all selected skeletons on vectors of \em T with \em size elements. The inputs hold 0 and 1
+ * only and the in-place skeletons are involutions, so repeated calls neither overflow nor denormalize.
+ */
+template <typename T>
+void benchmarkType(Benchmark& benchmark, const BenchmarkConfig& config, const std::string& type,
+                   GlobalIndex size, int threads) {
+    if (!selected(config.types, type))
+        return;
+
+    VectorDistribution<T> a(size, [] (GlobalIndex i) { return T(i & 1); });
+    VectorDistribution<T> b(size, [] (GlobalIndex i) { return T((i >> 1) & 1); });
+    VectorDistribution<T> out(a);
+    std::vector<T> gathered(Utils::proc_rank == 0 ? size : 0);
+
+    auto twice = [] (T x) { return x + x; };
+    auto flip = [] (T x) { return T(1) - x; };
+    auto addIndex = [] (GlobalIndex i, T x) { return x + T(i & 1); };
+    auto multiply = [] (T x, T y) { return x * y; };
+    auto average = [] (const Neighborhood<T>& n) { return n[-1] + n[0] + n[1]; };
+    std::plus<T> plus;
+    volatile T sink = T();
+
+    auto run = [&] (const std::string& skeleton, double elementBytes, auto&& call) {
+        if (!selected(config.skeletons, skeleton))
+            return;
+        BenchmarkResult result;
+        result.skeleton = skeleton;
+        result.type = type;
+        result.mode = config.weak ? "weak" : "strong";
+        result.size = size;
+        result.processes = Utils::num_procs;
+        result.threads = threads;
+        result.repetitions = benchmark.getRepetitions();
+        result.bytes = elementBytes * (double)size;
+        result.time = benchmark.measure(call);
+        benchmark.add(result);
+    };
+
+    const double s = sizeof(T);
+    run("map", 2 * s, [&] () { out = a.template map<T>(twice); });
+    run("mapInPlace", 2 * s, [&] () { out.mapInPlace(flip); });
+    run("mapIndex", 2 * s, [&] () { out = a.template mapIndex<T>(addIndex); });
+    run("zip", 3 * s, [&] () { out = a.template zip<T>(b, multiply); });
+    run("zipInPlace", 3 * s, [&] () { out.zipInPlace(b, multiply); });
+    run("reduce", s, [&] () { sink = a.reduce(plus); });
+    run("allReduce", s, [&] () { sink = a.allReduce(plus); });
+    run("mapReduce", 2 * s, [&] () { sink = a.template zip<T>(b, multiply).reduce(plus); });
+    run("scan", 2 * s, [&] () { out = a.scan(plus); });
+    run("mapStencil", 2 * s, [&] () { a.template mapStencil<T>(1, average, out); });
+    run("gather", s, [&] () { a.gatherVectors(gathered); });
+    (void)sink;
+}
+
+int main(int argc, char** argv) {
+    initSkeletons(argc, argv);
+
+    BenchmarkConfig config;
+    int warmups = 2;
+    int repetitions = 10;
+    bool json = false;
+    std::string output;
+    int c;
+
+    while ((c = getopt(argc, argv, "s:t:n:u:k:y:m:f:o:w")) != -1) {
+        switch (c) {
+            case 's':
+                config.sizes = parseList<GlobalIndex>(optarg);
+                break;
+            case 't':
+                config.threads = parseList<int>(optarg);
+                break;
+            case 'n':
+                repetitions = atoi(optarg);
+                break;
+            case 'u':
+                warmups = atoi(optarg);
+                break;
+            case 'k':
+                config.skeletons = parseList<std::string>(optarg);
+                break;
+            case 'y':
+                config.types = parseList<std::string>(optarg);
+                break;
+            case 'm':
+                config.weak = std::string(optarg) == "weak";
+                break;
+            case 'f':
+                json = std::string(optarg) == "json";
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'w':
+                Utils::use_shared_windows = true;
+                break;
+            case '?':
+                return 1;
+            default:
+                abort();
+        }
+    }
+
+    {
+        Benchmark benchmark(warmups, repetitions);
+        std::vector<double> baseline;
+        GlobalIndex largest = *std::max_element(config.sizes.begin(), config.sizes.end());
+
+        for (int threads : config.threads) {
+            omp_set_num_threads(threads);
+
+            // the baseline streams at least 32 MB per array so that it does not run from the caches
+            GlobalIndex streamElements = std::max<GlobalIndex>(config.weak ? largest : largest / Utils::num_procs,
+                                                               GlobalIndex(1) << 22);
+            if ((int)baseline.size() <= threads)
+                baseline.resize(threads + 1, 0);
+            baseline[threads] = benchmark.streamTriad(streamElements);
+
+            for (GlobalIndex size : config.sizes) {
+                // weak scaling keeps the elements per process constant
+                GlobalIndex globalSize = config.weak ? size * Utils::num_procs : size;
+                benchmarkType<int>(benchmark, config, "int", globalSize, threads);
+                benchmarkType<long>(benchmark, config, "long", globalSize, threads);
+                benchmarkType<float>(benchmark, config, "float", globalSize, threads);
+                benchmarkType<double>(benchmark, config, "double", globalSize, threads);
+            }
+        }
+
+        if (Utils::proc_rank == 0) {
+            std::ofstream file;
+            if (!output.empty())
+                file.open(output);
+            std::ostream& out = output.empty() ? std::cout : file;
+            if (json)
+                benchmark.writeJson(out, baseline);
+            else
+                benchmark.writeCsv(out, baseline);
+        }
+    }
+
+    terminateSkeletons();
+    return 0;
+}
@@ -0,0 +1,124 @@
+#ifndef MPI_OPENMP_BENCHMARK_HPP
+#define MPI_OPENMP_BENCHMARK_HPP
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+#include "Utils.hpp"
+#include "Communicator.hpp"
+
+/**
+ * \brief Struct BenchmarkStatistics summarizes the run times of the measured repetitions in seconds.
+ */
+struct BenchmarkStatistics {
+    double min;
+    double p10;
+    double median;
+    double p90;
+    double max;
+    double mean;
+};
+
+/**
+ * \brief Computes the statistics of \em samples. Percentiles interpolate linearly between the two
+ * nearest samples.
+ */
+BenchmarkStatistics computeStatistics(std::vector<double> samples);
+
+/**
+ * \brief Struct BenchmarkResult is one row of a benchmark report.
+ */
+struct BenchmarkResult {
+    std::string skeleton;
+    std::string type;
+    std::string mode; // "strong" or "weak"
+    GlobalIndex size; // global number of elements
+    int processes;
+    int threads;
+    int repetitions;
+    double bytes; // bytes read and written per call over all processes
+    BenchmarkStatistics time; // per repetition the slowest process
+
+    /**
+     * \brief Achieved bandwidth in GB/s of the median repetition.
+     */
+    double bandwidth() const;
+};
+
+/**
+ * \brief Class Benchmark times skeleton calls across all processes of a communicator and collects the
+ * results into CSV or JSON reports.
+ *
+ * Every repetition starts after a barrier and its time is the maximum over all processes, since a
+ * skeleton is only as fast as its slowest process. The maxima are combined with a single collective
+ * after the last repetition, so that no communication besides the barrier falls between the calls.
+ */
+class Benchmark {
+public:
+    /**
+     * @param warmups Untimed calls before the measurement.
+     * @param repetitions Timed calls, at least 1.
+     */
+    Benchmark(int warmups, int repetitions, const Communicator& communicator = Communicator());
+
+    /**
+     * \brief Calls \em f warmups + repetitions times and returns the statistics of the timed calls.
+     */
+    template <typename F>
+    BenchmarkStatistics measure(F&& f);
+
+    /**
+     * \brief Measures the STREAM triad a[i] = b[i] + s * c[i] over \em elementsPerProcess doubles per
+     * process with the current number of threads and returns the aggregated bandwidth in GB/s, the
+     * baseline the skeleton bandwidths are compared against.
+     */
+    double streamTriad(GlobalIndex elementsPerProcess);
+
+    void add(const BenchmarkResult& result);
+
+    const std::vector<BenchmarkResult>& getResults() const { return results; }
+
+    /**
+     * \brief Writes one line per result. \em baseline is the STREAM bandwidth per thread count, indexed
+     * by the number of threads; results without baseline report 0.
+     */
+    void writeCsv(std::ostream& out, const std::vector<double>& baseline) const;
+
+    void writeJson(std::ostream& out, const std::vector<double>& baseline) const;
+
+    int getWarmups() const { return warmups; }
+
+    int getRepetitions() const { return repetitions; }
+
+private:
+    int warmups;
+    int repetitions;
+    Communicator communicator;
+    std::vector<BenchmarkResult> results;
+
+    BenchmarkStatistics slowestProcess(std::vector<double>& times) const;
+
+    static double baselineOf(const std::vector<double>& baseline, int threads);
+};
+
+template <typename F>
+BenchmarkStatistics Benchmark::measure(F&& f) {
+    for (int i = 0; i < warmups; i++) {
+        f();
+    }
+
+    std::vector<double> times(repetitions);
+    for (int i = 0; i < repetitions; i++) {
+        MPI_Barrier(communicator.get());
+        double start = MPI_Wtime();
+        f();
+        times[i] = MPI_Wtime() - start;
+    }
+
+    return slowestProcess(times);
+}
+
+#endif //MPI_OPENMP_BENCHMARK_HPP
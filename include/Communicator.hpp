@@ -0,0 +1,127 @@
+#ifndef MPI_OPENMP_COMMUNICATOR_HPP
+#define MPI_OPENMP_COMMUNICATOR_HPP
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+class SharedWindow;
+
+struct NodeTopology;
+
+struct CommunicatorCache;
+
+/**
+ * \brief Class Communicator is the group of processes a distributed data structure lives on. By
+ * default this is MPI_COMM_WORLD; split() creates sub-communicators, so that independent pipelines
+ * (e.g. one per node or per task group) can run concurrently on disjoint processes.
+ *
+ * Communicators created by split() or cartesian() are freed together with their last copy. Copies are cheap and
+ * compare equal if they refer to the same MPI communicator.
+ */
+class Communicator {
+public:
+    /**
+     * \brief Refers to MPI_COMM_WORLD.
+     */
+    Communicator();
+
+    /**
+     * \brief Refers to the existing communicator \em comm, which stays owned by the caller.
+     */
+    explicit Communicator(MPI_Comm comm);
+
+    /**
+     * \brief Splits the communicator with MPI_Comm_split. Collective over all processes of this
+     * communicator; processes passing the same \em color end up in the same sub-communicator, ordered
+     * by \em key.
+     */
+    Communicator split(int color, int key = 0) const;
+
+    /**
+     * \brief Splits the communicator into groups of processes which share memory, i.e. one per node.
+     */
+    Communicator splitShared() const;
+
+    /**
+     * \brief Arranges the processes in a non-periodic \em rows x \em cols grid with MPI_Cart_create.
+     * The ranks are not reordered, grid position (r, c) holds rank r * cols + c. Collective;
+     * \em rows * \em cols has to equal the number of processes.
+     */
+    Communicator cartesian(int rows, int cols) const;
+
+    /**
+     * \brief Splits a grid created by cartesian() with MPI_Cart_sub into the sub-grids which keep the
+     * dimensions marked true, e.g. cartesianSub(false, true) yields one communicator per grid row.
+     */
+    Communicator cartesianSub(bool keepRows, bool keepCols) const;
+
+    MPI_Comm get() const { return comm; }
+
+    int getRank() const;
+
+    int getSize() const;
+
+    /**
+     * \brief Processes of this communicator grouped by node. Computed collectively on the first call
+     * and shared by all copies of the communicator.
+     */
+    const NodeTopology& getTopology() const;
+
+    /**
+     * \brief Duplicate of this communicator for the point-to-point messages of the library, so that
+     * their tags can never match receives the application posts on get(). Created with MPI_Comm_dup
+     * collectively on the first call and shared by all copies of the communicator.
+     */
+    MPI_Comm getPrivate() const;
+
+    bool operator==(const Communicator& other) const { return comm == other.comm; }
+
+    bool operator!=(const Communicator& other) const { return comm != other.comm; }
+
+private:
+    MPI_Comm comm;
+    // frees communicators created by split() and cartesian() with the last copy
+    std::shared_ptr<MPI_Comm> owner;
+    // node topology and private duplicate, created on demand
+    std::shared_ptr<CommunicatorCache> cache;
+
+    static Communicator own(MPI_Comm comm);
+};
+
+/**
+ * \brief Throws std::runtime_error with \em message on every process unless \em ok holds on all
+ * processes of \em communicator. Collective.
+ */
+void requireAll(bool ok, const std::string& message, const Communicator& communicator);
+
+/**
+ * \brief Struct NodeTopology describes how the processes of a communicator are placed on nodes. Each
+ * node has a leader (its process with the lowest rank), only the leaders take part in the inter-node
+ * part of hierarchical collectives.
+ */
+struct NodeTopology {
+    // processes on the same node, ordered by rank
+    Communicator node;
+    // leaders of all nodes ordered by rank, MPI_COMM_NULL on other processes
+    Communicator leaders;
+    // ranks of the processes on this node
+    std::vector<int> nodeRanks;
+    // whether every node holds consecutive ranks, so that node order and rank order agree
+    bool consecutive;
+
+    bool isLeader() const { return node.getRank() == 0; }
+
+    /**
+     * \brief Shared scratch memory of at least \em bytes bytes per process, reallocated if it is too
+     * small. Collective over the node, all processes have to request the same size.
+     */
+    SharedWindow& getScratch(std::size_t bytes) const;
+
+    mutable std::shared_ptr<SharedWindow> scratch;
+};
+
+#endif //MPI_OPENMP_COMMUNICATOR_HPP
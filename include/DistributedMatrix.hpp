@@ -0,0 +1,252 @@
+#ifndef MPI_OPENMP_DISTRIBUTEDMATRIX_HPP
+#define MPI_OPENMP_DISTRIBUTEDMATRIX_HPP
+#pragma once
+
+#include <vector>
+#include <climits>
+#include <iostream>
+#include <string>
+#include <functional>
+#include <mpi.h>
+#include <omp.h>
+#include <type_traits>
+#include <stdexcept>
+
+#include "Utils.hpp"
+#include "Communicator.hpp"
+#include "LocalAllocator.hpp"
+#include "MatrixLayout.hpp"
+#include "MpiTypes.hpp"
+#include "Profiler.hpp"
+#include "VectorDistribution.hpp"
+
+/**
+ * \brief Class DistributedMatrix is a dense rows x cols matrix distributed in two-dimensional blocks
+ * over a grid of processes (see MatrixLayout). It provides the data-parallel skeletons map, zip and
+ * reduce, the row and column reductions reduceRows and reduceCols, which only communicate within a grid
+ * row or grid column, and the matrix-vector product with a VectorDistribution.
+ *
+ * Vectors produced by the matrix are balanced blocks over the communicator of the layout; multiply
+ * accepts any vector with a contiguous distribution on that communicator.
+ *
+ * @tparam T Element type.
+ */
+template <typename T>
+class DistributedMatrix {
+public:
+    DistributedMatrix();
+
+    /**
+     * \brief Creates a rows x cols matrix, collective over \em communicator since it creates the grid.
+     * @param gridRows Number of grid rows, 0 chooses a grid as square as possible.
+     * @param tileSize Edge length of the tiles of the local block.
+     */
+    DistributedMatrix(GlobalIndex rows, GlobalIndex cols, const Communicator& communicator = Communicator(),
+                      int gridRows = 0, GlobalIndex tileSize = 64);
+
+    /**
+     * \brief Creates a matrix with the same distribution as every other matrix of \em layout, no
+     * communication.
+     */
+    explicit DistributedMatrix(const MatrixLayout& layout);
+
+    /**
+     * \brief Creates a matrix of \em layout whose element (i, j) is f(i, j) for global indices i and j.
+     * Every process fills its own block in parallel without communication.
+     */
+    template <typename Generator,
+              typename = typename std::enable_if<std::is_invocable<Generator&, GlobalIndex, GlobalIndex>::value>::type>
+    DistributedMatrix(const MatrixLayout& layout, Generator f);
+
+    DistributedMatrix(const DistributedMatrix<T>& cs);
+
+    DistributedMatrix(DistributedMatrix<T>&& other) noexcept = default;
+
+    DistributedMatrix<T>& operator=(const DistributedMatrix<T>& cs);
+
+    DistributedMatrix<T>& operator=(DistributedMatrix<T>&& other) noexcept = default;
+
+    const MatrixLayout& getLayout() const { return layout; }
+
+    GlobalIndex getRows() const { return layout.getRows(); }
+
+    GlobalIndex getCols() const { return layout.getCols(); }
+
+    GlobalIndex getLocalRows() const { return layout.getLocalRows(); }
+
+    GlobalIndex getLocalCols() const { return layout.getLocalCols(); }
+
+    GlobalIndex getFirstRow() const { return layout.getFirstRow(); }
+
+    GlobalIndex getFirstCol() const { return layout.getFirstCol(); }
+
+    const Communicator& getCommunicator() const { return layout.getCommunicator(); }
+
+    /**
+     * \brief Element (\em i, \em j) of the local block, i.e. global element (getFirstRow() + i, getFirstCol() + j).
+     */
+    T getLocal(GlobalIndex i, GlobalIndex j) const { return localMatrix[layout.offsetOf(i, j)]; }
+
+    void setLocal(GlobalIndex i, GlobalIndex j, const T& value) { localMatrix[layout.offsetOf(i, j)] = value; }
+
+    /**
+     * \brief Tiled local storage, see MatrixLayout::offsetOf.
+     */
+    T* getLocalData() { return localMatrix.data(); }
+
+    const T* getLocalData() const { return localMatrix.data(); }
+
+    /**
+     * \brief Gathers the matrix in row-major order into \em results on rank 0, which is resized to
+     * rows * cols elements. Other processes leave \em results untouched.
+     */
+    void gatherMatrix(std::vector<T>& results) const;
+
+    /**
+     * \brief Prints the matrix row by row on rank 0.
+     */
+    void show(const std::string& descr) const;
+
+    /**
+     * \brief Applies \em f to every element and returns the results in a matrix of the same layout.
+     */
+    template <typename R, typename MapFunctor>
+    DistributedMatrix<R> map(MapFunctor& f) const;
+
+    /**
+     * \brief Applies \em f to every element and writes the results into \em out, which is recreated if
+     * its layout differs.
+     */
+    template <typename R, typename MapFunctor>
+    void map(MapFunctor& f, DistributedMatrix<R>& out) const;
+
+    template <typename MapFunctor>
+    void mapInPlace(MapFunctor& f);
+
+    /**
+     * \brief Combines every element with the element of \em b at the same position, \em b needs the
+     * same layout.
+     */
+    template <typename R, typename T2, typename ZipFunctor>
+    DistributedMatrix<R> zip(const DistributedMatrix<T2>& b, ZipFunctor& f) const;
+
+    template <typename R, typename T2, typename ZipFunctor>
+    void zip(const DistributedMatrix<T2>& b, ZipFunctor& f, DistributedMatrix<R>& out) const;
+
+    template <typename T2, typename ZipFunctor>
+    void zipInPlace(const DistributedMatrix<T2>& b, ZipFunctor& f);
+
+    /**
+     * \brief Reduces all elements with the associative functor \em f. Every process folds its block row
+     * by row, the partial results are combined in rank order; with more than one grid column this
+     * differs from the row-major order of the elements, so \em f has to be commutative as well. The
+     * neutral element is taken from ReduceIdentity; if none is known, the folds start from their first
+     * elements and empty blocks are skipped.
+     */
+    template <typename ReduceFunctor>
+    T reduce(ReduceFunctor& f) const;
+
+    template <typename ReduceFunctor>
+    T reduce(ReduceFunctor& f, const T& identity) const;
+
+    /**
+     * \brief Like reduce, but every process receives the result.
+     */
+    template <typename ReduceFunctor>
+    T allReduce(ReduceFunctor& f) const;
+
+    template <typename ReduceFunctor>
+    T allReduce(ReduceFunctor& f, const T& identity) const;
+
+    /**
+     * \brief Reduces every row with the associative functor \em f, starting from its neutral element (or,
+     * as in reduce, from the first element of the row), and returns the rows x 1 result as a balanced
+     * VectorDistribution. The columns of a row are folded in order; the partial results of a grid row
+     * are combined over its row communicator only.
+     */
+    template <typename ReduceFunctor>
+    VectorDistribution<T> reduceRows(ReduceFunctor& f) const;
+
+    template <typename ReduceFunctor>
+    VectorDistribution<T> reduceRows(ReduceFunctor& f, const T& identity) const;
+
+    /**
+     * \brief Reduces every column like reduceRows reduces the rows, communicating within grid columns.
+     */
+    template <typename ReduceFunctor>
+    VectorDistribution<T> reduceCols(ReduceFunctor& f) const;
+
+    template <typename ReduceFunctor>
+    VectorDistribution<T> reduceCols(ReduceFunctor& f, const T& identity) const;
+
+    /**
+     * \brief Matrix-vector product y = A x. \em x needs cols elements in a contiguous distribution on
+     * the communicator of the matrix. Every process fetches the part of x matching its columns, the
+     * partial products are summed within the grid rows and distributed as a balanced vector.
+     */
+    VectorDistribution<T> multiply(const VectorDistribution<T>& x) const;
+
+    /**
+     * \brief Like multiply above, but writes into \em y, whose local block is reused if it already is a
+     * balanced vector of rows elements on the communicator of the matrix.
+     */
+    void multiply(const VectorDistribution<T>& x, VectorDistribution<T>& y) const;
+
+private:
+    template <typename U>
+    friend class DistributedMatrix;
+
+    MatrixLayout layout;
+    std::vector<T, LocalAllocator<T>> localMatrix;
+
+    void init();
+
+    /**
+     * \brief Calls body(i, j, offset, width) for every tile row of the local block: local row \em i,
+     * columns [j, j + width) stored contiguously from \em offset. The rows are split statically over the
+     * threads, so every thread always works on the same pages.
+     */
+    template <typename Body>
+    void forEachSegment(Body body) const;
+
+    /**
+     * \brief Folds the local block starting from \em identity, or from its first element if \em identity
+     * is null; empty only in the latter case.
+     */
+    template <typename ReduceFunctor>
+    OptionalValue<T> reduceBlock(ReduceFunctor& f, const T* identity) const;
+
+    /**
+     * \brief Implements reduce and allReduce; a null \em identity stands for the one from ReduceIdentity,
+     * or, if none is known, for skipping empty blocks.
+     */
+    template <typename ReduceFunctor>
+    T reduceMatrix(ReduceFunctor& f, const T* identity, bool all) const;
+
+    /**
+     * \brief Implement reduceRows and reduceCols, \em identity as in reduceMatrix.
+     */
+    template <typename ReduceFunctor>
+    VectorDistribution<T> foldRows(ReduceFunctor& f, const T* identity) const;
+
+    template <typename ReduceFunctor>
+    VectorDistribution<T> foldCols(ReduceFunctor& f, const T* identity) const;
+
+    /**
+     * \brief Combines the partial rows or columns of the processes of \em communicator on its rank 0 into
+     * \em results, skipping the processes whose partials are not \em valid since their block is empty.
+     */
+    template <typename ReduceFunctor>
+    void combinePartials(const std::vector<T>& partials, bool valid, std::vector<T>& results, ReduceFunctor& f,
+                         const Communicator& communicator) const;
+
+    /**
+     * \brief Distributes the rows or columns [first, first + count) held on the root of a grid row or
+     * column into the balanced vector \em out.
+     */
+    void toVector(const T* data, GlobalIndex first, GlobalIndex count, VectorDistribution<T>& out) const;
+};
+
+#include "../src/DistributedMatrix.cpp"
+
+#endif //MPI_OPENMP_DISTRIBUTEDMATRIX_HPP
@@ -0,0 +1,123 @@
+#ifndef MPI_OPENMP_DISTRIBUTION_HPP
+#define MPI_OPENMP_DISTRIBUTION_HPP
+#pragma once
+
+#include <vector>
+
+#include "Utils.hpp"
+
+/**
+ * \brief Class Distribution describes how the elements of a distributed data structure are assigned
+ * to the processes. It is used by VectorDistribution for the layout of the local blocks, gathers,
+ * scatters and the conversion between local and global indices.
+ *
+ * Local elements are always stored in ascending global index order. Concatenating the local blocks
+ * in rank order gives the "block order" of the elements, which equals the global order for the
+ * contiguous (block) distributions.
+ */
+class Distribution {
+public:
+    enum Kind {
+        BLOCK,          // contiguous blocks, sizes given by offsets
+        BLOCK_CYCLIC    // blocks of blockSize elements dealt round-robin to the processes
+    };
+
+    /**
+     * \brief Creates an empty distribution over no processes.
+     */
+    Distribution();
+
+    /**
+     * \brief Contiguous blocks whose sizes differ by at most one element. The first
+     * \em size % \em numProcesses processes get the additional elements.
+     */
+    static Distribution balancedBlock(GlobalIndex size, int numProcesses);
+
+    /**
+     * \brief Blocks of \em blockSize consecutive elements, assigned round-robin to the processes.
+     */
+    static Distribution blockCyclic(GlobalIndex size, int numProcesses, GlobalIndex blockSize);
+
+    /**
+     * \brief Contiguous blocks whose sizes are proportional to \em weights, e.g. the relative speed of
+     * heterogeneous nodes. Needs one non-negative weight per process.
+     */
+    static Distribution weightedBlock(GlobalIndex size, const std::vector<double>& weights);
+
+    /**
+     * \brief Contiguous blocks of the given sizes, one per process, e.g. the blocks left by a filter.
+     */
+    static Distribution irregularBlock(const std::vector<GlobalIndex>& localSizes);
+
+    Kind getKind() const { return kind; }
+
+    GlobalIndex getSize() const { return size; }
+
+    int getNumProcesses() const { return numProcesses; }
+
+    /**
+     * \brief Number of elements stored on \em process.
+     */
+    GlobalIndex localSizeOf(int process) const { return offsets[process + 1] - offsets[process]; }
+
+    /**
+     * \brief Position of the block of \em process in block order, i.e. the number of elements stored
+     * on lower ranks.
+     */
+    GlobalIndex offsetOf(int process) const { return offsets[process]; }
+
+    /**
+     * \brief Global index of the first element of \em process.
+     */
+    GlobalIndex firstIndexOf(int process) const { return globalIndex(process, 0); }
+
+    /**
+     * \brief Global index of the element at \em localIndex on \em process.
+     */
+    GlobalIndex globalIndex(int process, GlobalIndex localIndex) const;
+
+    /**
+     * \brief Rank of the process storing the element at \em globalIndex.
+     */
+    int ownerOf(GlobalIndex globalIndex) const;
+
+    /**
+     * \brief Local index of the element at \em globalIndex on its owner.
+     */
+    GlobalIndex localIndexOf(GlobalIndex globalIndex) const;
+
+    /**
+     * \brief Number of elements from \em globalIndex on which are stored one after another on the same
+     * process: the rest of the block for BLOCK, the rest of the round-robin block for BLOCK_CYCLIC.
+     */
+    GlobalIndex runLength(GlobalIndex globalIndex) const;
+
+    /**
+     * \brief Whether every process stores a contiguous range of global indices in rank order.
+     */
+    bool isContiguous() const { return kind == BLOCK; }
+
+    /**
+     * \brief Whether every process stores the same number of elements.
+     */
+    bool isUniform() const;
+
+    bool operator==(const Distribution& other) const;
+
+    bool operator!=(const Distribution& other) const { return !(*this == other); }
+
+private:
+    Kind kind;
+    // number of elements
+    GlobalIndex size;
+    // number of processes
+    int numProcesses;
+    // size of the round-robin blocks, only used by BLOCK_CYCLIC
+    GlobalIndex blockSize;
+    // offsets[p] is the number of elements on processes < p, numProcesses + 1 entries
+    std::vector<GlobalIndex> offsets;
+
+    Distribution(Kind kind, GlobalIndex size, int numProcesses, GlobalIndex blockSize);
+};
+
+#endif //MPI_OPENMP_DISTRIBUTION_HPP
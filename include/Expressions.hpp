@@ -0,0 +1,506 @@
+#ifndef MPI_OPENMP_EXPRESSIONS_HPP
+#define MPI_OPENMP_EXPRESSIONS_HPP
+#pragma once
+
+#include <vector>
+#include <string>
+#include <type_traits>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <mpi.h>
+#include <omp.h>
+
+#include "Utils.hpp"
+#include "Distribution.hpp"
+#include "Communicator.hpp"
+#include "functors.hpp"
+#include "MpiTypes.hpp"
+#include "Profiler.hpp"
+
+template <typename T>
+class VectorDistribution;
+
+template <typename R, typename E, typename MapFunctor>
+class MapExpression;
+
+template <typename R, typename E1, typename E2, typename ZipFunctor>
+class ZipExpression;
+
+template <typename R, typename E, typename MapFunctor>
+class MapIndexExpression;
+
+template <typename R, typename E1, typename E2, typename ZipFunctor>
+class ZipIndexExpression;
+
+class IndexExpression;
+
+template <typename T, typename ReduceFunctor>
+class ReducePlan;
+
+/**
+ * \brief Struct IsMapIndexFunctor checks whether \em F can be called as R f(GlobalIndex, T) const.
+ */
+template <typename F, typename T, typename R>
+struct IsMapIndexFunctor : std::is_invocable_r<R, const F&, GlobalIndex, T> {};
+
+/**
+ * \brief Struct IsZipIndexFunctor checks whether \em F can be called as R f(GlobalIndex, T1, T2) const.
+ */
+template <typename F, typename T1, typename T2, typename R>
+struct IsZipIndexFunctor : std::is_invocable_r<R, const F&, GlobalIndex, T1, T2> {};
+
+/**
+ * \brief Class DistributionTerminal is the leaf of a lazy skeleton expression. It refers to the local
+ * block of an existing VectorDistribution without copying it.
+ *
+ * @tparam T Element type.
+ */
+template <typename T>
+class DistributionTerminal {
+public:
+    typedef T value_type;
+
+    /**
+     * \brief Creates a terminal referring to the local block of \em vd.
+     * @param vd Distribution to read from. It has to outlive the terminal.
+     */
+    explicit DistributionTerminal(const VectorDistribution<T>& vd);
+
+    T operator()(GlobalIndex localIndex) const { return data[localIndex]; }
+
+    GlobalIndex getSize() const { return distribution->getSize(); }
+
+    GlobalIndex getLocalSize() const { return localSize; }
+
+    const Distribution& getDistribution() const { return *distribution; }
+
+    const Communicator& getCommunicator() const { return *communicator; }
+
+private:
+    const T* data;
+    GlobalIndex localSize;
+    const Distribution* distribution;
+    const Communicator* communicator;
+};
+
+/**
+ * \brief Maps a VectorDistribution to its DistributionTerminal and leaves expressions untouched, so
+ * that both can be used as operands of a lazy skeleton.
+ */
+template <typename E>
+struct ExpressionOf {
+    typedef E type;
+
+    static const E& get(const E& e) { return e; }
+};
+
+template <typename T>
+struct ExpressionOf<VectorDistribution<T>> {
+    typedef DistributionTerminal<T> type;
+
+    static DistributionTerminal<T> get(const VectorDistribution<T>& vd) { return DistributionTerminal<T>(vd); }
+};
+
+/**
+ * \brief Class SkeletonExpression is the base of all lazy skeleton expressions. Calling map or zip on
+ * an expression only records the functor; the work runs as one fused OpenMP loop over the local block
+ * when the expression is reduced, gathered or assigned to a VectorDistribution.
+ *
+ * @tparam Derived Concrete expression type (CRTP).
+ * @tparam R Element type produced by the expression.
+ */
+template <typename Derived, typename R>
+class SkeletonExpression {
+public:
+    typedef R value_type;
+
+    template <typename R2, typename MapFunctor>
+    MapExpression<R2, Derived, MapFunctor> map(MapFunctor &f) const;
+
+    template <typename R2, typename Other, typename ZipFunctor>
+    ZipExpression<R2, Derived, typename ExpressionOf<Other>::type, ZipFunctor> zip(const Other& b, ZipFunctor& f) const;
+
+    /**
+     * \brief Like map, but \em f is called as R2 f(GlobalIndex, T) with the global index of the element.
+     */
+    template <typename R2, typename MapFunctor>
+    MapIndexExpression<R2, Derived, MapFunctor> mapIndex(MapFunctor &f) const;
+
+    /**
+     * \brief Like zip, but \em f is called as R2 f(GlobalIndex, T, T2) with the global index of the elements.
+     */
+    template <typename R2, typename Other, typename ZipFunctor>
+    ZipIndexExpression<R2, Derived, typename ExpressionOf<Other>::type, ZipFunctor>
+    zipIndex(const Other& b, ZipFunctor& f) const;
+
+    template <typename ReduceFunctor>
+    R reduce(ReduceFunctor &f) const;
+
+    template <typename ReduceFunctor>
+    R reduce(ReduceFunctor &f, const R& identity) const;
+
+    template <typename ReduceFunctor>
+    R allReduce(ReduceFunctor &f) const;
+
+    template <typename ReduceFunctor>
+    R allReduce(ReduceFunctor &f, const R& identity) const;
+
+    template <typename ReduceFunctor>
+    SkeletonFuture<R> reduceAsync(ReduceFunctor &f) const;
+
+    template <typename ReduceFunctor>
+    SkeletonFuture<R> reduceAsync(ReduceFunctor &f, const R& identity) const;
+
+    template <typename ReduceFunctor>
+    R reduce(ReducePlan<R, ReduceFunctor>& plan) const;
+
+    void gatherVectors(std::vector<R>& results) const;
+
+    void show(const std::string& descr) const;
+
+    const Derived& derived() const { return static_cast<const Derived&>(*this); }
+};
+
+/**
+ * \brief Class IndexExpression is a leaf expression which yields the global index of every local
+ * element. Mapping it gives a fused generator, see generate().
+ */
+class IndexExpression : public SkeletonExpression<IndexExpression, GlobalIndex> {
+public:
+    IndexExpression(const Distribution& distribution, const Communicator& communicator)
+        : distribution(distribution), communicator(communicator), rank(communicator.getRank()),
+          firstIndex(distribution.firstIndexOf(rank)), localSize(distribution.localSizeOf(rank)),
+          contiguous(distribution.isContiguous()) {}
+
+    GlobalIndex operator()(GlobalIndex localIndex) const {
+        return contiguous ? firstIndex + localIndex : distribution.globalIndex(rank, localIndex);
+    }
+
+    GlobalIndex getSize() const { return distribution.getSize(); }
+
+    GlobalIndex getLocalSize() const { return localSize; }
+
+    const Distribution& getDistribution() const { return distribution; }
+
+    const Communicator& getCommunicator() const { return communicator; }
+
+private:
+    Distribution distribution;
+    Communicator communicator;
+    int rank;
+    GlobalIndex firstIndex;
+    GlobalIndex localSize;
+    bool contiguous;
+};
+
+/**
+ * \brief Class MapExpression applies a map functor to every element of its source expression.
+ *
+ * @tparam R Output data type.
+ * @tparam E Source expression type.
+ * @tparam MapFunctor Functor type.
+ */
+template <typename R, typename E, typename MapFunctor>
+class MapExpression : public SkeletonExpression<MapExpression<R, E, MapFunctor>, R> {
+    static_assert(IsMapFunctor<MapFunctor, typename E::value_type, R>::value,
+                  "map: functor has to be callable as R f(T) const");
+
+public:
+    MapExpression(const E& source, const MapFunctor& f) : source(source), f(f) {}
+
+    R operator()(GlobalIndex localIndex) const { return f(source(localIndex)); }
+
+    GlobalIndex getSize() const { return source.getSize(); }
+
+    GlobalIndex getLocalSize() const { return source.getLocalSize(); }
+
+    const Distribution& getDistribution() const { return source.getDistribution(); }
+
+    const Communicator& getCommunicator() const { return source.getCommunicator(); }
+
+private:
+    E source;
+    typename FunctorStorage<MapFunctor>::type f;
+};
+
+/**
+ * \brief Class ZipExpression combines the elements of two source expressions with a zip functor.
+ *
+ * @tparam R Output data type.
+ * @tparam E1 Left source expression type.
+ * @tparam E2 Right source expression type.
+ * @tparam ZipFunctor Functor type.
+ */
+template <typename R, typename E1, typename E2, typename ZipFunctor>
+class ZipExpression : public SkeletonExpression<ZipExpression<R, E1, E2, ZipFunctor>, R> {
+    static_assert(IsZipFunctor<ZipFunctor, typename E1::value_type, typename E2::value_type, R>::value,
+                  "zip: functor has to be callable as R f(T, T2) const");
+
+public:
+    /**
+     * \brief Creates the expression. Both operands need the same distribution and communicator,
+     * otherwise std::invalid_argument is thrown.
+     */
+    ZipExpression(const E1& a, const E2& b, const ZipFunctor& f);
+
+    R operator()(GlobalIndex localIndex) const { return f(a(localIndex), b(localIndex)); }
+
+    GlobalIndex getSize() const { return a.getSize(); }
+
+    GlobalIndex getLocalSize() const { return a.getLocalSize(); }
+
+    const Distribution& getDistribution() const { return a.getDistribution(); }
+
+    const Communicator& getCommunicator() const { return a.getCommunicator(); }
+
+private:
+    E1 a;
+    E2 b;
+    typename FunctorStorage<ZipFunctor>::type f;
+};
+
+/**
+ * \brief Class MapIndexExpression applies a functor R f(GlobalIndex, T) to every element of its source
+ * expression and its global index.
+ */
+template <typename R, typename E, typename MapFunctor>
+class MapIndexExpression : public SkeletonExpression<MapIndexExpression<R, E, MapFunctor>, R> {
+    static_assert(IsMapIndexFunctor<MapFunctor, typename E::value_type, R>::value,
+                  "mapIndex: functor has to be callable as R f(GlobalIndex, T) const");
+
+public:
+    MapIndexExpression(const E& source, const MapFunctor& f)
+        : source(source), f(f), indices(source.getDistribution(), source.getCommunicator()) {}
+
+    R operator()(GlobalIndex localIndex) const { return f(indices(localIndex), source(localIndex)); }
+
+    GlobalIndex getSize() const { return source.getSize(); }
+
+    GlobalIndex getLocalSize() const { return source.getLocalSize(); }
+
+    const Distribution& getDistribution() const { return source.getDistribution(); }
+
+    const Communicator& getCommunicator() const { return source.getCommunicator(); }
+
+private:
+    E source;
+    typename FunctorStorage<MapFunctor>::type f;
+    IndexExpression indices;
+};
+
+/**
+ * \brief Class ZipIndexExpression combines the elements of two source expressions and their global
+ * index with a functor R f(GlobalIndex, T1, T2).
+ */
+template <typename R, typename E1, typename E2, typename ZipFunctor>
+class ZipIndexExpression : public SkeletonExpression<ZipIndexExpression<R, E1, E2, ZipFunctor>, R> {
+    static_assert(IsZipIndexFunctor<ZipFunctor, typename E1::value_type, typename E2::value_type, R>::value,
+                  "zipIndex: functor has to be callable as R f(GlobalIndex, T, T2) const");
+
+public:
+    /**
+     * \brief Creates the expression. Both operands need the same distribution and communicator,
+     * otherwise std::invalid_argument is thrown.
+     */
+    ZipIndexExpression(const E1& a, const E2& b, const ZipFunctor& f);
+
+    R operator()(GlobalIndex localIndex) const { return f(indices(localIndex), a(localIndex), b(localIndex)); }
+
+    GlobalIndex getSize() const { return a.getSize(); }
+
+    GlobalIndex getLocalSize() const { return a.getLocalSize(); }
+
+    const Distribution& getDistribution() const { return a.getDistribution(); }
+
+    const Communicator& getCommunicator() const { return a.getCommunicator(); }
+
+private:
+    E1 a;
+    E2 b;
+    typename FunctorStorage<ZipFunctor>::type f;
+    IndexExpression indices;
+};
+
+/**
+ * \brief Struct PaddedValue holds the partial result of one thread on its own cache line, so that
+ * threads writing their partial results do not invalidate each other's lines.
+ */
+template <typename T>
+struct alignas(CACHE_LINE_SIZE) PaddedValue {
+    T value;
+};
+
+/**
+ * \brief Class ReducePlan prepares a reduction which is repeated many times, e.g. in an iterative
+ * solver or a benchmark loop. The plan keeps the per-thread partials, the MPI operation and the
+ * buffers of the collective, so a reduction with the plan allocates nothing. With MPI 4 the
+ * collective is created once with MPI_Allreduce_init/MPI_Reduce_init and only restarted afterwards.
+ *
+ * Creating a plan is collective. It has to be destroyed before terminateSkeletons() and \em f has
+ * to outlive it.
+ *
+ * @tparam T Element type.
+ * @tparam ReduceFunctor Functor type.
+ */
+template <typename T, typename ReduceFunctor>
+class ReducePlan {
+public:
+    /**
+     * \brief Creates a plan with the neutral element from ReduceIdentity, which has to be known for
+     * the functor; pass the identity explicitly otherwise.
+     * @param all Whether every process receives the result or only rank 0.
+     * @param communicator Processes taking part, has to be the communicator of the reduced data.
+     */
+    ReducePlan(ReduceFunctor& f, bool all, const Communicator& communicator = Communicator());
+
+    ReducePlan(ReduceFunctor& f, const T& identity, bool all, const Communicator& communicator = Communicator());
+
+    ReducePlan(const ReducePlan&) = delete;
+
+    ReducePlan& operator=(const ReducePlan&) = delete;
+
+    ~ReducePlan();
+
+    /**
+     * \brief Combines the partial result \em local of every process.
+     */
+    T combine(const T& local);
+
+    ReduceFunctor& getFunctor() const { return f; }
+
+    const T& getIdentity() const { return identity; }
+
+    const Communicator& getCommunicator() const { return communicator; }
+
+    // per-thread partials for reduceLocal, grown if the number of threads increases
+    std::vector<PaddedValue<T>>& getPartials();
+
+private:
+    typedef MpiBuiltinOp<T, typename std::remove_const<ReduceFunctor>::type> Builtin;
+
+    ReduceFunctor& f;
+    T identity;
+    bool all;
+    Communicator communicator;
+    // buffers bound to the collective
+    T local;
+    T result;
+    std::unique_ptr<MpiUserOp<T, ReduceFunctor>> userOp;
+    MPI_Op op;
+    MPI_Datatype datatype;
+    std::vector<PaddedValue<T>> partials;
+#if MPI_VERSION >= 4
+    MPI_Request request;
+#endif
+};
+
+/**
+ * \brief Struct SimdReduction detects reduce functors which OpenMP can vectorize with a builtin
+ * reduction operator (+ or *) when the element type is arithmetic. Only std::plus<R> and
+ * std::multiplies<R> or their transparent forms qualify; any other operand type converts the
+ * arguments, which the builtin operator would skip.
+ */
+template <typename R, typename ReduceFunctor>
+struct SimdReduction {
+    static const bool sum = false;
+    static const bool product = false;
+};
+
+template <typename R, typename X>
+struct SimdReduction<R, std::plus<X>> {
+    static const bool sum = std::is_arithmetic<R>::value && (std::is_same<X, R>::value || std::is_void<X>::value);
+    static const bool product = false;
+};
+
+template <typename R, typename X>
+struct SimdReduction<R, std::multiplies<X>> {
+    static const bool sum = false;
+    static const bool product = std::is_arithmetic<R>::value && (std::is_same<X, R>::value || std::is_void<X>::value);
+};
+
+/**
+ * \brief Evaluates \em e into \em out with one parallel loop over the local block.
+ */
+template <typename R, typename E>
+void evaluateExpression(const E& e, R* out);
+
+/**
+ * \brief Folds the local elements [begin, end) of \em e onto \em acc. Uses an omp simd reduction if
+ * SimdReduction allows it, and independent SIMD lanes for other commutative functors over arithmetic
+ * types; otherwise the elements are folded in index order.
+ */
+template <typename R, typename E, typename ReduceFunctor>
+R foldRange(const E& e, ReduceFunctor& f, R acc, GlobalIndex begin, GlobalIndex end);
+
+/**
+ * \brief Lazily generates the elements f(i) of a distribution with the layout \em distribution from
+ * their global index i. Nothing is stored until the expression is assigned, so the generator can be
+ * fused with map, zip and reduce.
+ */
+template <typename R, typename Generator>
+MapExpression<R, IndexExpression, Generator> generate(const Distribution& distribution, Generator& f,
+                                                     const Communicator& communicator = Communicator());
+
+/**
+ * \brief Folds the local block of \em e. Every thread folds a contiguous chunk starting from
+ * \em identity; the per-thread partials are merged in a tree in thread order, so \em f only has to
+ * be associative.
+ *
+ * @param identity Neutral element of \em f.
+ */
+template <typename R, typename E, typename ReduceFunctor>
+R reduceLocal(const E& e, ReduceFunctor& f, const R& identity);
+
+/**
+ * \brief Like reduceLocal, but stores the per-thread results in \em partials, which has to hold
+ * omp_get_max_threads() entries.
+ */
+template <typename R, typename E, typename ReduceFunctor>
+R reduceLocal(const E& e, ReduceFunctor& f, const R& identity, std::vector<PaddedValue<R>>& partials);
+
+/**
+ * \brief Like reduceLocal, for functors without a known neutral element: every thread starts from the
+ * first element of its chunk and empty chunks are skipped. Empty if the local block is empty.
+ */
+template <typename R, typename E, typename ReduceFunctor>
+OptionalValue<R> reduceLocalSeeded(const E& e, ReduceFunctor& f);
+
+/**
+ * \brief Folds the local block of \em e and combines the partial results of all processes.
+ * @param all Whether every process receives the result or only rank 0.
+ */
+template <typename R, typename E, typename ReduceFunctor>
+R reduceExpression(const E& e, ReduceFunctor& f, const R& identity, bool all);
+
+/**
+ * \brief Like reduceExpression above with the neutral element from ReduceIdentity. If none is known,
+ * the folds start from the first elements and processes with empty blocks are skipped; the result of
+ * an empty vector is then a value-initialized R.
+ */
+template <typename R, typename E, typename ReduceFunctor>
+R reduceExpression(const E& e, ReduceFunctor& f, bool all);
+
+/**
+ * \brief Folds the local block of \em e and combines the partial results with the collective
+ * prepared in \em plan.
+ */
+template <typename R, typename E, typename ReduceFunctor>
+R reduceExpression(const E& e, ReducePlan<R, ReduceFunctor>& plan);
+
+/**
+ * \brief Folds the local block of \em e and starts combining the partial results of all processes
+ * with MPI_Iallreduce.
+ */
+template <typename R, typename E, typename ReduceFunctor>
+SkeletonFuture<R> reduceExpressionAsync(const E& e, ReduceFunctor& f, const R& identity);
+
+/**
+ * \brief Like reduceExpressionAsync above with the neutral element handled as in reduceExpression(e, f, all).
+ */
+template <typename R, typename E, typename ReduceFunctor>
+SkeletonFuture<R> reduceExpressionAsync(const E& e, ReduceFunctor& f);
+
+#include "../src/Expressions.cpp"
+
+#endif //MPI_OPENMP_EXPRESSIONS_HPP
@@ -0,0 +1,61 @@
+#ifndef MPI_OPENMP_GATHERPLAN_HPP
+#define MPI_OPENMP_GATHERPLAN_HPP
+#pragma once
+
+#include <vector>
+#include <mpi.h>
+
+#include "VectorDistribution.hpp"
+
+/**
+ * \brief Class GatherPlan prepares a gather of a VectorDistribution which is repeated many times, e.g.
+ * to observe an iteration. The plan binds the local block and \em results once; with MPI 4 the
+ * collective is created once with MPI_Gatherv_init/MPI_Allgatherv_init and only restarted afterwards,
+ * otherwise the cached counts and displacements of the distribution are reused.
+ *
+ * Creating a plan is collective. The distribution must not be reallocated and \em results must not be
+ * resized while the plan exists (run() throws std::runtime_error on every process if they were), and the
+ * plan has to be destroyed before terminateSkeletons().
+ *
+ * @tparam T Element type.
+ */
+template <typename T>
+class GatherPlan {
+public:
+    /**
+     * @param results Receives all elements, resized to getSize() elements on the receiving processes.
+     * @param all Whether every process receives the elements or only rank 0.
+     */
+    GatherPlan(const VectorDistribution<T>& v, std::vector<T>& results, bool all = false);
+
+    GatherPlan(const GatherPlan&) = delete;
+
+    GatherPlan& operator=(const GatherPlan&) = delete;
+
+    ~GatherPlan();
+
+    /**
+     * \brief Gathers the current elements of the distribution into the results.
+     */
+    void run();
+
+private:
+    const VectorDistribution<T>& v;
+    std::vector<T>& results;
+    // storage of the local block and of results when the plan was created
+    const T* boundLocal;
+    GlobalIndex boundLocalSize;
+    const T* boundResults;
+    bool all;
+    bool receives;
+    // staging buffer in block order for non-contiguous distributions
+    std::vector<T> blocks;
+#if MPI_VERSION >= 4
+    // persistent collective, MPI_REQUEST_NULL above INT_MAX elements
+    MPI_Request request;
+#endif
+};
+
+#include "../src/GatherPlan.cpp"
+
+#endif //MPI_OPENMP_GATHERPLAN_HPP
@@ -0,0 +1,65 @@
+#ifndef MPI_OPENMP_LOCALALLOCATOR_HPP
+#define MPI_OPENMP_LOCALALLOCATOR_HPP
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "Utils.hpp"
+
+// alignment of local blocks, enough for cache lines and the widest SIMD registers (AVX-512)
+constexpr std::size_t LOCAL_ALIGNMENT = 64;
+
+// size of a transparent huge page
+constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/**
+ * \brief Class LocalAllocator allocates the local blocks of distributed data structures.
+ *
+ * Memory is aligned to LOCAL_ALIGNMENT and elements are default-initialized instead of
+ * value-initialized, so resizing a block does not touch its pages. The owner touches them first from
+ * an OpenMP loop with the same static schedule the skeletons use, which places every page on the
+ * NUMA node of the thread that later works on it. Blocks of at least HUGE_PAGE_SIZE bytes are backed
+ * by transparent huge pages if Utils::use_huge_pages is set.
+ *
+ * @tparam T Element type.
+ */
+template <typename T>
+class LocalAllocator {
+public:
+    typedef T value_type;
+
+    LocalAllocator() noexcept {}
+
+    template <typename U>
+    LocalAllocator(const LocalAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n);
+
+    void deallocate(T* p, std::size_t n) noexcept;
+
+    /**
+     * \brief Default-initializes the element at \em p, which leaves trivial types uninitialized.
+     */
+    template <typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value) {
+        ::new((void*)p) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new((void*)p) U(std::forward<Args>(args)...);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const LocalAllocator<T>&, const LocalAllocator<U>&) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const LocalAllocator<T>&, const LocalAllocator<U>&) { return false; }
+
+#include "../src/LocalAllocator.cpp"
+
+#endif //MPI_OPENMP_LOCALALLOCATOR_HPP
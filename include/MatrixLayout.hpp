@@ -0,0 +1,164 @@
+#ifndef MPI_OPENMP_MATRIXLAYOUT_HPP
+#define MPI_OPENMP_MATRIXLAYOUT_HPP
+#pragma once
+
+#include "Utils.hpp"
+#include "Distribution.hpp"
+#include "Communicator.hpp"
+
+/**
+ * \brief Class MatrixLayout describes how a DistributedMatrix is split over a gridRows x gridCols grid
+ * of processes and how the local block is stored.
+ *
+ * Grid row r holds the matrix rows of block r of Distribution::balancedBlock(rows, gridRows), grid
+ * column c the matrix columns of block c of balancedBlock(cols, gridCols); process (r, c) has rank
+ * r * gridCols + c. A grid of one column distributes whole rows (block-row distribution).
+ *
+ * The local block is stored in square tiles of tileSize x tileSize elements, row-major inside a tile
+ * and tiles in row-major order. Tiles at the right and bottom border are padded, so every tile starts
+ * at a multiple of tileSize * tileSize elements. Tiles keep the working set of the column-wise
+ * skeletons (reduceCols, multiply) in cache, while every tile row is still contiguous.
+ *
+ * Layouts are cheap to copy and share their grid communicators, matrices created from the same layout
+ * need no communication to be combined.
+ */
+class MatrixLayout {
+public:
+    /**
+     * \brief Creates an empty layout over no processes.
+     */
+    MatrixLayout();
+
+    /**
+     * \brief Creates the process grid, collective over \em communicator.
+     * @param gridRows Number of grid rows, a divisor of the number of processes. 0 chooses a grid as
+     * square as possible with MPI_Dims_create, the number of processes gives a block-row distribution.
+     * @param tileSize Edge length of the tiles of the local block.
+     */
+    MatrixLayout(GlobalIndex rows, GlobalIndex cols, const Communicator& communicator = Communicator(),
+                 int gridRows = 0, GlobalIndex tileSize = 64);
+
+    GlobalIndex getRows() const { return rows; }
+
+    GlobalIndex getCols() const { return cols; }
+
+    int getGridRows() const { return gridRows; }
+
+    int getGridCols() const { return gridCols; }
+
+    /**
+     * \brief Grid row of this process.
+     */
+    int getGridRow() const { return gridRow; }
+
+    /**
+     * \brief Grid column of this process.
+     */
+    int getGridCol() const { return gridCol; }
+
+    /**
+     * \brief Rows of the matrix per grid row.
+     */
+    const Distribution& getRowDistribution() const { return rowDistribution; }
+
+    /**
+     * \brief Columns of the matrix per grid column.
+     */
+    const Distribution& getColDistribution() const { return colDistribution; }
+
+    GlobalIndex getLocalRows() const { return localRows; }
+
+    GlobalIndex getLocalCols() const { return localCols; }
+
+    /**
+     * \brief Global index of the first local row.
+     */
+    GlobalIndex getFirstRow() const { return firstRow; }
+
+    /**
+     * \brief Global index of the first local column.
+     */
+    GlobalIndex getFirstCol() const { return firstCol; }
+
+    GlobalIndex getTileSize() const { return tileSize; }
+
+    /**
+     * \brief Number of tiles per local column.
+     */
+    GlobalIndex getTileRows() const { return tileRows; }
+
+    /**
+     * \brief Number of tiles per local row.
+     */
+    GlobalIndex getTileCols() const { return tileCols; }
+
+    /**
+     * \brief Number of elements of the local storage, including the padding of the border tiles.
+     */
+    GlobalIndex getStorageSize() const { return tileRows * tileCols * tileSize * tileSize; }
+
+    /**
+     * \brief Position of the first element of the tile (\em tileRow, \em tileCol) in the local storage.
+     */
+    GlobalIndex tileOffset(GlobalIndex tileRow, GlobalIndex tileCol) const {
+        return (tileRow * tileCols + tileCol) * tileSize * tileSize;
+    }
+
+    /**
+     * \brief Position of the local element (\em i, \em j) in the local storage.
+     */
+    GlobalIndex offsetOf(GlobalIndex i, GlobalIndex j) const {
+        return tileOffset(i / tileSize, j / tileSize) + (i % tileSize) * tileSize + j % tileSize;
+    }
+
+    /**
+     * \brief The communicator the matrix was created on; vectors interoperating with the matrix live on it.
+     */
+    const Communicator& getCommunicator() const { return communicator; }
+
+    /**
+     * \brief The processes as a Cartesian grid; ranks equal those of getCommunicator().
+     */
+    const Communicator& getGrid() const { return grid; }
+
+    /**
+     * \brief The processes of the grid row of this process, ranked by grid column.
+     */
+    const Communicator& getRowCommunicator() const { return rowCommunicator; }
+
+    /**
+     * \brief The processes of the grid column of this process, ranked by grid row.
+     */
+    const Communicator& getColCommunicator() const { return colCommunicator; }
+
+    /**
+     * \brief Whether both layouts assign the same elements to the same processes of the same communicator
+     * and store them alike.
+     */
+    bool operator==(const MatrixLayout& other) const;
+
+    bool operator!=(const MatrixLayout& other) const { return !(*this == other); }
+
+private:
+    GlobalIndex rows;
+    GlobalIndex cols;
+    int gridRows;
+    int gridCols;
+    int gridRow;
+    int gridCol;
+    Distribution rowDistribution;
+    Distribution colDistribution;
+    GlobalIndex localRows;
+    GlobalIndex localCols;
+    GlobalIndex firstRow;
+    GlobalIndex firstCol;
+    GlobalIndex tileSize;
+    GlobalIndex tileRows;
+    GlobalIndex tileCols;
+    Communicator communicator;
+    Communicator grid;
+    Communicator rowCommunicator;
+    Communicator colCommunicator;
+};
+
+#endif //MPI_OPENMP_MATRIXLAYOUT_HPP
@@ -0,0 +1,218 @@
+#ifndef MPI_OPENMP_MPITYPES_HPP
+#define MPI_OPENMP_MPITYPES_HPP
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include <mpi.h>
+
+#include "Utils.hpp"
+#include "functors.hpp"
+#include "SkeletonRequest.hpp"
+#include "Communicator.hpp"
+#include "SharedWindow.hpp"
+
+/**
+ * \brief Struct MpiDatatype maps an element type to the MPI datatype used to communicate it.
+ * Arithmetic types map to the predefined MPI types, every other type to a contiguous block of
+ * sizeof(T) bytes which is created and committed on first use.
+ *
+ * @tparam T Element type.
+ */
+template <typename T>
+struct MpiDatatype {
+    static const bool builtin = false;
+
+    static MPI_Datatype get();
+};
+
+#define MPI_OPENMP_BUILTIN_DATATYPE(TYPE, MPI_TYPE) \
+    template <>                                     \
+    struct MpiDatatype<TYPE> {                      \
+        static const bool builtin = true;           \
+        static MPI_Datatype get() { return MPI_TYPE; } \
+    };
+
+MPI_OPENMP_BUILTIN_DATATYPE(char, MPI_CHAR)
+MPI_OPENMP_BUILTIN_DATATYPE(signed char, MPI_SIGNED_CHAR)
+MPI_OPENMP_BUILTIN_DATATYPE(unsigned char, MPI_UNSIGNED_CHAR)
+MPI_OPENMP_BUILTIN_DATATYPE(short, MPI_SHORT)
+MPI_OPENMP_BUILTIN_DATATYPE(unsigned short, MPI_UNSIGNED_SHORT)
+MPI_OPENMP_BUILTIN_DATATYPE(int, MPI_INT)
+MPI_OPENMP_BUILTIN_DATATYPE(unsigned int, MPI_UNSIGNED)
+MPI_OPENMP_BUILTIN_DATATYPE(long, MPI_LONG)
+MPI_OPENMP_BUILTIN_DATATYPE(unsigned long, MPI_UNSIGNED_LONG)
+MPI_OPENMP_BUILTIN_DATATYPE(long long, MPI_LONG_LONG)
+MPI_OPENMP_BUILTIN_DATATYPE(unsigned long long, MPI_UNSIGNED_LONG_LONG)
+MPI_OPENMP_BUILTIN_DATATYPE(float, MPI_FLOAT)
+MPI_OPENMP_BUILTIN_DATATYPE(double, MPI_DOUBLE)
+MPI_OPENMP_BUILTIN_DATATYPE(long double, MPI_LONG_DOUBLE)
+MPI_OPENMP_BUILTIN_DATATYPE(bool, MPI_CXX_BOOL)
+
+#undef MPI_OPENMP_BUILTIN_DATATYPE
+
+/**
+ * \brief Creates and commits a datatype describing \em count consecutive elements of type T, so that
+ * blocks with more than 2^31 - 1 elements (or bytes) can be sent with a count of 1. The datatype
+ * is built from chunks of 2^20 elements plus a remainder and has to be freed by the caller.
+ *
+ * @tparam T Element type.
+ * @param count Number of elements.
+ */
+template <typename T>
+MPI_Datatype createLargeDatatype(GlobalIndex count);
+
+/**
+ * \brief Struct MpiBuiltinOp detects reduce functors which have a predefined MPI operation, so that
+ * MPI can use its own (possibly hardware accelerated) implementation. Only available for builtin
+ * datatypes.
+ *
+ * @tparam T Element type.
+ * @tparam ReduceFunctor Functor type.
+ */
+template <typename T, typename ReduceFunctor>
+struct MpiBuiltinOp {
+    static const bool available = false;
+
+    static MPI_Op get() { return MPI_OP_NULL; }
+};
+
+#define MPI_OPENMP_BUILTIN_OP(FUNCTOR, MPI_OPERATION)                         \
+    template <typename T>                                                     \
+    struct MpiBuiltinOp<T, FUNCTOR<T>> {                                      \
+        static const bool available = MpiDatatype<T>::builtin;                \
+        static MPI_Op get() { return MPI_OPERATION; }                         \
+    };                                                                        \
+    template <typename T>                                                     \
+    struct MpiBuiltinOp<T, FUNCTOR<void>> {                                   \
+        static const bool available = MpiDatatype<T>::builtin;                \
+        static MPI_Op get() { return MPI_OPERATION; }                         \
+    };
+
+MPI_OPENMP_BUILTIN_OP(std::plus, MPI_SUM)
+MPI_OPENMP_BUILTIN_OP(std::multiplies, MPI_PROD)
+MPI_OPENMP_BUILTIN_OP(std::logical_and, MPI_LAND)
+MPI_OPENMP_BUILTIN_OP(std::logical_or, MPI_LOR)
+MPI_OPENMP_BUILTIN_OP(std::bit_and, MPI_BAND)
+MPI_OPENMP_BUILTIN_OP(std::bit_or, MPI_BOR)
+MPI_OPENMP_BUILTIN_OP(std::bit_xor, MPI_BXOR)
+
+#undef MPI_OPENMP_BUILTIN_OP
+
+/**
+ * \brief Class MpiUserOp wraps a reduce functor into an MPI_Op. MPI only accepts plain function
+ * pointers, so the functor travels with the datatype: every operation owns a duplicate of
+ * MpiDatatype<T> with the functor attached as attribute, and apply() reads it back from the datatype
+ * MPI passes in. Collectives with the operation have to use getDatatype(); several operations with
+ * the same functor type, even pending non-blocking ones or ones on other threads, do not interfere.
+ *
+ * The functor has to outlive the operation, which has to be destroyed before terminateSkeletons().
+ *
+ * @tparam T Element type.
+ * @tparam ReduceFunctor Functor type.
+ */
+template <typename T, typename ReduceFunctor>
+class MpiUserOp {
+public:
+    /**
+     * \brief Creates the operation. The functor has to be associative; unless \em commutative is set,
+     * MPI combines the partial results in rank order.
+     */
+    MpiUserOp(ReduceFunctor& f, bool commutative = false);
+
+    MpiUserOp(const MpiUserOp&) = delete;
+
+    MpiUserOp& operator=(const MpiUserOp&) = delete;
+
+    ~MpiUserOp();
+
+    MPI_Op get() const { return op; }
+
+    /**
+     * \brief Datatype of the elements which carries the functor.
+     */
+    MPI_Datatype getDatatype() const { return datatype; }
+
+private:
+    MPI_Op op;
+    MPI_Datatype datatype;
+
+    // attribute key of the functor, created once per instantiation and kept until MPI_Finalize
+    static int keyval();
+
+    static void apply(void* in, void* inout, int* len, MPI_Datatype* datatype);
+};
+
+/**
+ * \brief Reduces \em local over all processes of \em comm with the MPI operation \em op on elements of
+ * \em datatype.
+ */
+template <typename T>
+T reduceWithOp(const T& local, MPI_Op op, MPI_Datatype datatype, bool all, MPI_Comm comm);
+
+/**
+ * \brief Combines the partial result \em local of every process of \em comm with \em f. Uses
+ * MPI_Allreduce if \em all is set and MPI_Reduce to rank 0 otherwise.
+ *
+ * @return The combined result; on ranks other than 0 a value-initialized T unless \em all is set.
+ */
+template <typename T, typename ReduceFunctor>
+T combineProcessResults(const T& local, ReduceFunctor& f, bool all, MPI_Comm comm);
+
+/**
+ * \brief Combines the partial results \em local of all processes of lower rank with \em f
+ * (MPI_Exscan). Rank 0 receives \em identity.
+ */
+template <typename T, typename ReduceFunctor>
+T exscanProcessResults(const T& local, ReduceFunctor& f, const T& identity, MPI_Comm comm);
+
+/**
+ * \brief Like combineProcessResults above, but hierarchical if Utils::use_shared_windows is set: the
+ * processes of a node exchange their partial results through a shared window, the node leader folds
+ * them with direct loads and only the leaders take part in the inter-node collective. Falls back to
+ * the flat collective if T is not trivially copyable or the nodes do not hold consecutive ranks.
+ */
+template <typename T, typename ReduceFunctor>
+T combineProcessResults(const T& local, ReduceFunctor& f, bool all, const Communicator& comm);
+
+/**
+ * \brief Non-blocking variant of combineProcessResults with MPI_Iallreduce; every process receives
+ * the result. \em f has to outlive the completion of the returned future.
+ */
+template <typename T, typename ReduceFunctor>
+SkeletonFuture<T> combineProcessResultsAsync(const T& local, ReduceFunctor& f, MPI_Comm comm);
+
+/**
+ * \brief Like combineProcessResultsAsync for partial results which may be empty. The future yields the
+ * combination of the non-empty partial results, a value-initialized T if all are empty.
+ */
+template <typename T, typename ReduceFunctor>
+SkeletonFuture<T> combineOptionalResultsAsync(const OptionalValue<T>& local, ReduceFunctor& f, MPI_Comm comm);
+
+/**
+ * \brief Combines the arrays \em local of all processes of \em comm elementwise with \em f into
+ * \em result on the process \em root (MPI_Reduce), e.g. the partial row sums of a matrix. Arrays of
+ * more than INT_MAX elements are reduced in several calls.
+ */
+template <typename T, typename ReduceFunctor>
+void combineProcessArrays(const T* local, T* result, GlobalIndex count, ReduceFunctor& f, int root, MPI_Comm comm);
+
+/**
+ * \brief Moves elements of a global index range between processes with MPI_Alltoallv. Every process
+ * holds the elements [first, first + count) in \em data and receives [outFirst, outFirst + outCount)
+ * into \em out; the held ranges must not overlap and have to cover all requested ones. Collective.
+ * Throws std::runtime_error on every process if more than INT_MAX elements go from one process to another.
+ */
+template <typename T>
+void redistributeRange(const T* data, GlobalIndex first, GlobalIndex count, T* out, GlobalIndex outFirst,
+                       GlobalIndex outCount, MPI_Comm comm);
+
+#include "../src/MpiTypes.cpp"
+
+#endif //MPI_OPENMP_MPITYPES_HPP
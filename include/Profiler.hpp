@@ -0,0 +1,241 @@
+#ifndef MPI_OPENMP_PROFILER_HPP
+#define MPI_OPENMP_PROFILER_HPP
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include <omp.h>
+
+#include "Utils.hpp"
+#include "Communicator.hpp"
+
+/*
+ * The skeletons are instrumented with ProfileScope and ThreadTimer. Unless the library is compiled with
+ * SKELETON_PROFILING (cmake -DSKELETON_PROFILING=ON) both are empty classes and the instrumentation
+ * compiles to nothing. With SKELETON_PROFILING the hooks cost one branch per skeleton call as long as
+ * profiling is not switched on at run time with Profiler::enable or the environment variable
+ * SKELETON_TRACE.
+ */
+
+/**
+ * \brief A skeleton call is timed as a whole (PROFILE_CALL), its MPI calls additionally as nested
+ * PROFILE_COMMUNICATION phases. The compute time is the difference.
+ */
+enum ProfilePhase { PROFILE_CALL, PROFILE_COMMUNICATION };
+
+/**
+ * \brief Struct SkeletonProfile accumulates all calls of one skeleton on this process.
+ */
+struct SkeletonProfile {
+    std::string skeleton;
+    long long calls = 0;
+    double time = 0; // seconds in the calls
+    double communicationTime = 0; // seconds in MPI calls, including waiting for other processes
+    long long bytesSent = 0;
+    long long bytesReceived = 0;
+    long long parallelRegions = 0;
+    double threadImbalance = 0; // sum over the parallel regions of slowest / mean thread time
+
+    double getComputeTime() const { return time - communicationTime; }
+
+    /**
+     * \brief Mean ratio of the slowest to the mean thread time, 1 for a perfectly balanced loop.
+     */
+    double getThreadImbalance() const { return parallelRegions > 0 ? threadImbalance / parallelRegions : 1; }
+};
+
+/**
+ * \brief Struct RankImbalance compares one skeleton across the processes of a communicator. A slow process
+ * shows up as a large maxCompute / meanCompute, a slow network as a communication time that is high on
+ * every process.
+ */
+struct RankImbalance {
+    double maxCompute;
+    double meanCompute;
+    double maxCommunication;
+    double meanCommunication;
+    int slowestRank; // process with the largest compute time
+};
+
+/**
+ * \brief Class Profiler collects the per-process profile of the skeleton calls and an event trace which
+ * is written in the Chrome trace format (chrome://tracing, Perfetto).
+ *
+ * Profiles are named after the skeleton: evaluate (assigning a lazy map/zip expression), mapInPlace,
+ * mapIndexInPlace, zipInPlace, reduce, allReduce, reduceAsync, reduceByKey, histogram, scan, exscan, sort,
+ * filter, redistribute, mapStencil, gather, gatherStream, scatter, readFile and writeFile; DistributedMatrix
+ * adds map, zip, reduceRows, reduceCols, multiply and gatherMatrix.
+ */
+class Profiler {
+public:
+    /**
+     * \brief Switches profiling on. If \em tracePrefix is not empty, terminateSkeletons() writes the
+     * trace of every process to <tracePrefix>.<rank>.json. Without SKELETON_PROFILING nothing is recorded.
+     * @param maxEvents Events kept for the trace, further calls only enter the profiles.
+     */
+    static void enable(const std::string& tracePrefix = "", size_t maxEvents = 1 << 20);
+
+    static void disable();
+
+    static bool isEnabled() { return enabled; }
+
+    /**
+     * \brief Clears profiles and trace.
+     */
+    static void reset();
+
+    /**
+     * \brief Profiles of all skeletons called on this process, ordered by name.
+     */
+    static std::vector<SkeletonProfile> getProfiles();
+
+    /**
+     * \brief Profile of \em skeleton on this process, empty if it has not been called.
+     */
+    static SkeletonProfile getProfile(const std::string& skeleton);
+
+    /**
+     * \brief Compares the profile of \em skeleton across all processes of \em communicator. Collective.
+     */
+    static RankImbalance compareRanks(const std::string& skeleton, const Communicator& communicator = Communicator());
+
+    /**
+     * \brief Writes the trace of this process in the Chrome trace event format.
+     */
+    static void writeTrace(const std::string& path);
+
+    /**
+     * \brief Writes the trace if a trace prefix was set, called by terminateSkeletons().
+     */
+    static void finish();
+
+    static void record(const char* skeleton, ProfilePhase phase, double start, double end,
+                       long long bytesSent, long long bytesReceived);
+
+    static void recordThreads(const char* skeleton, const double* starts, const double* ends, int numThreads);
+
+    /**
+     * \brief Skeleton of the innermost running ProfileScope of the calling thread, the owner of the
+     * parallel regions it starts.
+     */
+    static thread_local const char* current;
+
+    // distance of the time slots of neighboring threads, which lie on different cache lines
+    static constexpr int THREAD_STRIDE = CACHE_LINE_SIZE / sizeof(double);
+
+private:
+    struct Event {
+        const char* name;
+        const char* category;
+        double start;
+        double duration;
+        int thread;
+        long long bytesSent;
+        long long bytesReceived;
+    };
+
+    static bool enabled;
+    static std::string tracePrefix;
+    static size_t maxEvents;
+    static double origin;
+    static std::vector<SkeletonProfile> profiles;
+    static std::vector<Event> events;
+
+    static SkeletonProfile& profileOf(const char* skeleton);
+
+    static void addEvent(const Event& event);
+};
+
+/**
+ * \brief Class ProfileScope times a phase of a skeleton call from its construction to its destruction.
+ */
+class ProfileScope {
+public:
+#ifdef SKELETON_PROFILING
+    ProfileScope(const char* skeleton, ProfilePhase phase)
+        : skeleton(skeleton), outer(Profiler::current), phase(phase), bytesSent(0), bytesReceived(0),
+          start(Profiler::isEnabled() ? MPI_Wtime() : -1) {
+        Profiler::current = skeleton;
+    }
+
+    ~ProfileScope() {
+        Profiler::current = outer;
+        if (start >= 0)
+            Profiler::record(skeleton, phase, start, MPI_Wtime(), bytesSent, bytesReceived);
+    }
+
+    void addBytes(long long sent, long long received) {
+        bytesSent += sent;
+        bytesReceived += received;
+    }
+
+private:
+    const char* skeleton;
+    const char* outer;
+    ProfilePhase phase;
+    long long bytesSent;
+    long long bytesReceived;
+    double start;
+#else
+    ProfileScope(const char*, ProfilePhase) {}
+
+    void addBytes(long long, long long) {}
+#endif
+
+    ProfileScope(const ProfileScope&) = delete;
+
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+/**
+ * \brief Class ThreadTimer times every thread of a parallel region. start() and stop() are called by each
+ * thread inside the region, the times are recorded for the current skeleton on destruction.
+ */
+class ThreadTimer {
+public:
+#ifdef SKELETON_PROFILING
+    ThreadTimer() : skeleton(Profiler::current), numThreads(0) {
+        if (Profiler::isEnabled()) {
+            starts.resize(omp_get_max_threads() * Profiler::THREAD_STRIDE);
+            ends.resize(omp_get_max_threads() * Profiler::THREAD_STRIDE);
+        }
+    }
+
+    ~ThreadTimer() {
+        if (!starts.empty() && numThreads > 0)
+            Profiler::recordThreads(skeleton, starts.data(), ends.data(), numThreads);
+    }
+
+    void start() {
+        if (!starts.empty()) {
+            starts[omp_get_thread_num() * Profiler::THREAD_STRIDE] = omp_get_wtime();
+            if (omp_get_thread_num() == 0)
+                numThreads = omp_get_num_threads();
+        }
+    }
+
+    void stop() {
+        if (!ends.empty())
+            ends[omp_get_thread_num() * Profiler::THREAD_STRIDE] = omp_get_wtime();
+    }
+
+private:
+    const char* skeleton;
+    int numThreads;
+    std::vector<double> starts;
+    std::vector<double> ends;
+#else
+    ThreadTimer() {}
+
+    void start() {}
+
+    void stop() {}
+#endif
+
+    ThreadTimer(const ThreadTimer&) = delete;
+
+    ThreadTimer& operator=(const ThreadTimer&) = delete;
+};
+
+#endif //MPI_OPENMP_PROFILER_HPP
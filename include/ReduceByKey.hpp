@@ -0,0 +1,55 @@
+#ifndef MPI_OPENMP_REDUCEBYKEY_HPP
+#define MPI_OPENMP_REDUCEBYKEY_HPP
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include "Utils.hpp"
+
+/**
+ * \brief Struct KeyValue is one group of the result of VectorDistribution::reduceByKey: a key and the
+ * combination of the values of all elements with this key.
+ *
+ * @tparam K Key type.
+ * @tparam V Value type.
+ */
+template <typename K, typename V>
+struct KeyValue {
+    K key;
+    V value;
+};
+
+/**
+ * \brief Hash which assigns keys to processes and threads. std::hash is the identity for integers, the
+ * finalizer of splitmix64 spreads consecutive keys evenly over all residues.
+ */
+template <typename K>
+std::uint64_t hashKey(const K& key) {
+    std::uint64_t h = std::hash<K>()(key);
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+/**
+ * \brief Hash table of one thread during reduceByKey.
+ */
+template <typename K, typename V>
+using KeyTable = std::unordered_map<K, V>;
+
+/**
+ * \brief Adds \em value to the group of \em key in \em table, combining it with \em combine if the key
+ * is already present.
+ */
+template <typename K, typename V, typename ReduceFunctor>
+void insertKey(KeyTable<K, V>& table, const K& key, const V& value, ReduceFunctor& combine) {
+    auto it = table.find(key);
+    if (it == table.end())
+        table.emplace(key, value);
+    else
+        it->second = combine(it->second, value);
+}
+
+#endif //MPI_OPENMP_REDUCEBYKEY_HPP
@@ -0,0 +1,62 @@
+#ifndef MPI_OPENMP_SHAREDWINDOW_HPP
+#define MPI_OPENMP_SHAREDWINDOW_HPP
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <mpi.h>
+
+#include "Communicator.hpp"
+
+/**
+ * \brief Class SharedWindow is memory which all processes of a node can load from and store to
+ * directly, allocated with MPI_Win_allocate_shared. Every process owns one segment; the segments of
+ * the other processes are reached through getSegment().
+ *
+ * Creating and destroying a window is collective over the node communicator. The window stays in a
+ * passive access epoch for its whole lifetime, sync() orders the loads and stores of all processes.
+ */
+class SharedWindow {
+public:
+    /**
+     * \brief Allocates a segment of \em bytes bytes on every process of \em node.
+     */
+    SharedWindow(std::size_t bytes, const Communicator& node);
+
+    SharedWindow(const SharedWindow&) = delete;
+
+    SharedWindow& operator=(const SharedWindow&) = delete;
+
+    ~SharedWindow();
+
+    /**
+     * \brief Segment of the calling process.
+     */
+    void* getLocal() const { return segments[node.getRank()]; }
+
+    /**
+     * \brief Segment of the process \em nodeRank of the node communicator.
+     */
+    void* getSegment(int nodeRank) const { return segments[nodeRank]; }
+
+    std::size_t getSegmentSize(int nodeRank) const { return sizes[nodeRank]; }
+
+    /**
+     * \brief Whether the segments follow each other without gaps in node rank order.
+     */
+    bool isContiguous() const { return contiguous; }
+
+    /**
+     * \brief Makes the stores of every process visible to all others. Collective over the node.
+     */
+    void sync() const;
+
+private:
+    Communicator node;
+    MPI_Win window;
+    std::vector<char*> segments;
+    std::vector<std::size_t> sizes;
+    bool contiguous;
+};
+
+#endif //MPI_OPENMP_SHAREDWINDOW_HPP
@@ -0,0 +1,111 @@
+#ifndef MPI_OPENMP_SKELETONREQUEST_HPP
+#define MPI_OPENMP_SKELETONREQUEST_HPP
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <mpi.h>
+
+/**
+ * \brief Class SkeletonRequest is the handle of a non-blocking skeleton. The skeleton has started its
+ * MPI communication when the handle is returned; the caller can keep computing and complete the
+ * communication later with wait() or poll it with test(). Calling test() from time to time also lets
+ * MPI libraries without an asynchronous progress thread advance the communication.
+ *
+ * Handles are move-only. Destroying a pending handle waits for its completion, since MPI may still
+ * write into the buffers it owns. The state kept alive for the communication (buffers, operations) is
+ * released as soon as the handle has completed, so a completed handle may outlive terminateSkeletons();
+ * a pending handle has to be completed before.
+ */
+class SkeletonRequest {
+public:
+    SkeletonRequest();
+
+    SkeletonRequest(SkeletonRequest&& other) noexcept;
+
+    SkeletonRequest& operator=(SkeletonRequest&& other) noexcept;
+
+    SkeletonRequest(const SkeletonRequest&) = delete;
+
+    SkeletonRequest& operator=(const SkeletonRequest&) = delete;
+
+    virtual ~SkeletonRequest();
+
+    /**
+     * \brief Blocks until the communication has completed.
+     */
+    void wait();
+
+    /**
+     * \brief Checks without blocking whether the communication has completed.
+     */
+    bool test();
+
+    /**
+     * \brief Adds an MPI request which has to complete before the skeleton does.
+     */
+    MPI_Request* addRequest();
+
+    /**
+     * \brief Keeps \em state (buffers, counts, operations) alive until the communication has completed.
+     */
+    void keepAlive(std::shared_ptr<void> state);
+
+    /**
+     * \brief Sets a function which runs once after all requests have completed, e.g. to reorder data.
+     */
+    void onComplete(std::function<void()> f);
+
+protected:
+    /**
+     * \brief Runs after the completion function, right before the state is released, e.g. to copy a
+     * result out of it.
+     */
+    virtual void collect() {}
+
+private:
+    std::vector<MPI_Request> requests;
+    std::function<void()> completion;
+    std::shared_ptr<void> state;
+    bool completed;
+
+    void complete();
+};
+
+/**
+ * \brief Class SkeletonFuture is the handle of a non-blocking skeleton which produces a value, e.g.
+ * VectorDistribution::reduceAsync.
+ *
+ * @tparam T Type of the result.
+ */
+template <typename T>
+class SkeletonFuture : public SkeletonRequest {
+public:
+    /**
+     * \brief Creates a future whose result is written to \em result by the communication.
+     * @param result Buffer owned by the state passed to keepAlive.
+     */
+    explicit SkeletonFuture(const T* result = nullptr) : result(result), value() {}
+
+    /**
+     * \brief Waits for the communication and returns the result.
+     */
+    T get() {
+        wait();
+        return value;
+    }
+
+protected:
+    void collect() override {
+        if (result != nullptr)
+            value = *result;
+        result = nullptr;
+    }
+
+private:
+    const T* result;
+    T value;
+};
+
+#endif //MPI_OPENMP_SKELETONREQUEST_HPP
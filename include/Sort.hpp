@@ -0,0 +1,71 @@
+#ifndef MPI_OPENMP_SORT_HPP
+#define MPI_OPENMP_SORT_HPP
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <mpi.h>
+#include <omp.h>
+
+#include "Utils.hpp"
+#include "Communicator.hpp"
+#include "MpiTypes.hpp"
+#include "Profiler.hpp"
+
+/*
+ * Building blocks of the sample sort behind VectorDistribution::sort. Every process sorts its block
+ * with parallelSort, the processes agree on splitters with selectSplitters, cut their sorted block into
+ * one bucket per process with splitPositions and exchange the buckets with MPI_Alltoallv. The received
+ * buckets are sorted runs, which mergeRuns combines.
+ */
+
+// samples every process contributes per process of the communicator, on average
+constexpr GlobalIndex SORT_SAMPLES_PER_PROCESS = 32;
+
+/**
+ * \brief Struct SortedRun refers to \em size sorted elements starting at \em data.
+ */
+template <typename T>
+struct SortedRun {
+    const T* data;
+    GlobalIndex size;
+};
+
+/**
+ * \brief Merges the sorted \em runs into \em out with all threads. The output is cut into one part per
+ * thread at splitters sampled from the runs; each thread merges its part of every run with a heap, so
+ * equal elements keep the order of their runs.
+ */
+template <typename T, typename Comparator>
+void mergeRuns(const std::vector<SortedRun<T>>& runs, T* out, Comparator& comp);
+
+/**
+ * \brief Sorts the \em n elements of \em data into \em out with all threads: every thread sorts the
+ * chunk it gets from a static schedule, then the chunks are merged with mergeRuns. \em data is left
+ * sorted chunk by chunk.
+ */
+template <typename T, typename Comparator>
+void parallelSort(T* data, GlobalIndex n, T* out, Comparator& comp);
+
+/**
+ * \brief Chooses one splitter less than there are processes from regular samples of the sorted local
+ * blocks. Every process samples in proportion to its block size, so the buckets are balanced even for
+ * irregular blocks. Collective; empty if the vector of \em globalSize elements is empty.
+ */
+template <typename T, typename Comparator>
+std::vector<T> selectSplitters(const T* sorted, GlobalIndex n, GlobalIndex globalSize, Comparator& comp,
+                               const Communicator& communicator);
+
+/**
+ * \brief Cuts the sorted block into one bucket per splitter plus one: bucket p is [bounds[p], bounds[p + 1])
+ * and holds the elements between splitter p - 1 and splitter p. Elements equal to a splitter which
+ * occurs several times are spread evenly over the buckets between its copies, so a frequent key does not
+ * end up on a single process.
+ */
+template <typename T, typename Comparator>
+std::vector<GlobalIndex> splitPositions(const T* sorted, GlobalIndex n, const std::vector<T>& splitters,
+                                        Comparator& comp);
+
+#include "../src/Sort.cpp"
+
+#endif //MPI_OPENMP_SORT_HPP
@@ -0,0 +1,61 @@
+#ifndef MPI_OPENMP_STENCIL_HPP
+#define MPI_OPENMP_STENCIL_HPP
+#pragma once
+
+#include <stdexcept>
+#include <type_traits>
+
+#include "Utils.hpp"
+
+/**
+ * \brief Values a stencil sees beyond the first and last element of a distributed vector.
+ * PERIODIC wraps around, FIXED uses a given boundary value and CLAMPED repeats the outermost element.
+ */
+enum BoundaryMode { PERIODIC, FIXED, CLAMPED };
+
+/**
+ * \brief Class Neighborhood is the view a stencil functor gets on one element and its neighbors up to
+ * the stencil radius, regardless of whether they are local or were received as halo.
+ *
+ * @tparam T Element type.
+ */
+template <typename T>
+class Neighborhood {
+public:
+    Neighborhood(const T* center, GlobalIndex radius, GlobalIndex index)
+        : center(center), radius(radius), index(index) {}
+
+    /**
+     * \brief Element at distance \em offset from the center, -getRadius() <= offset <= getRadius().
+     */
+    const T& operator[](GlobalIndex offset) const { return center[offset]; }
+
+    /**
+     * \brief Like operator[], but throws std::out_of_range if \em offset exceeds the radius.
+     */
+    const T& at(GlobalIndex offset) const {
+        if (offset < -radius || offset > radius)
+            throw std::out_of_range("Neighborhood: offset exceeds the stencil radius");
+        return center[offset];
+    }
+
+    GlobalIndex getRadius() const { return radius; }
+
+    /**
+     * \brief Global index of the center element.
+     */
+    GlobalIndex getIndex() const { return index; }
+
+private:
+    const T* center;
+    GlobalIndex radius;
+    GlobalIndex index;
+};
+
+/**
+ * \brief Struct IsStencilFunctor checks whether \em F can be called as R f(const Neighborhood<T>&) const.
+ */
+template <typename F, typename T, typename R>
+struct IsStencilFunctor : std::is_invocable_r<R, const F&, const Neighborhood<T>&> {};
+
+#endif //MPI_OPENMP_STENCIL_HPP
@@ -3,17 +3,51 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <mpi.h>
 #include <omp.h>
 
+// size of a cache line, used to keep data of different threads apart
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// type of global and local element indices and sizes of distributed data structures
+typedef std::int64_t GlobalIndex;
+
 class Utils {
 public:
-    static int proc_rank; // process rank
-    static int num_procs; // total number of processes
+    static int proc_rank; // process rank in MPI_COMM_WORLD
+    static int num_procs; // total number of processes in MPI_COMM_WORLD
+    static int thread_level; // thread support level provided by MPI_Init_thread
+    static bool use_huge_pages; // back large local blocks with transparent huge pages
+    static bool use_shared_windows; // allocate local blocks in MPI-3 shared memory windows per node
 };
 
-void initSkeletons(int argc, char **argv);
+/**
+ * \brief Computes the iterations [begin, end) which \em thread gets from a loop over \em n iterations
+ * with schedule(static), so that manually partitioned loops touch the same data as the skeleton loops.
+ */
+void staticRange(GlobalIndex n, int thread, int numThreads, GlobalIndex& begin, GlobalIndex& end);
+
+/**
+ * \brief Initializes MPI with MPI_Init_thread and the thread support level \em threadLevel. The
+ * skeletons call MPI only from the master thread, which needs MPI_THREAD_FUNNELED. Some of these calls
+ * are made inside parallel regions, e.g. scan combines the block totals with MPI_Exscan from an omp
+ * master block while the other threads wait. Request MPI_THREAD_MULTIPLE to run skeletons on different
+ * communicators concurrently from several threads. Concurrent reductions may use the same functor type,
+ * since every MPI operation carries its own functor (see MpiUserOp). Throws std::runtime_error if MPI
+ * does not provide MPI_THREAD_FUNNELED, the level actually provided is stored in Utils::thread_level.
+ */
+void initSkeletons(int argc, char **argv, int threadLevel = MPI_THREAD_FUNNELED);
+
+/**
+ * \brief Throws std::runtime_error naming \em skeleton if MPI provides less than \em threadLevel.
+ */
+void requireThreadLevel(int threadLevel, const char* skeleton);
 
+/**
+ * \brief Writes the profiler trace if one was requested and finalizes MPI.
+ */
 void terminateSkeletons();
 
 #endif //MPI_OPENMP_UTILS_HPP
@@ -3,11 +3,31 @@
 #pragma once
 
 #include <vector>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include <memory>
 #include <mpi.h>
 #include <omp.h>
 #include <sstream>
+#include <type_traits>
+#include <stdexcept>
 
 #include "Utils.hpp"
+#include "Distribution.hpp"
+#include "Communicator.hpp"
+#include "LocalAllocator.hpp"
+#include "Expressions.hpp"
+#include "SkeletonRequest.hpp"
+#include "SharedWindow.hpp"
+#include "Stencil.hpp"
+#include "Sort.hpp"
+#include "ReduceByKey.hpp"
+#include "VectorFile.hpp"
+
+template <typename T>
+class GatherPlan;
 
 
 template <typename T>
@@ -16,66 +36,493 @@ public:
     VectorDistribution();
 
     /**
-     * \brief Creates a VectorDistribution of \em size elements.
+     * \brief Creates a VectorDistribution of \em size elements in balanced blocks.
      * @param size
+     * @param communicator Processes the elements are distributed over, MPI_COMM_WORLD by default.
+     */
+    VectorDistribution(GlobalIndex size, const Communicator& communicator = Communicator());
+
+    /**
+     * \brief Creates a VectorDistribution with the layout \em distribution.
+     * @param distribution Layout, has to span all processes of \em communicator.
      */
-    VectorDistribution(int size);
+    VectorDistribution(const Distribution& distribution, const Communicator& communicator = Communicator());
 
     VectorDistribution(const VectorDistribution<T>& cs);
 
+    /**
+     * \brief Takes over the local block of \em other without copying it. \em other is left empty.
+     */
+    VectorDistribution(VectorDistribution<T>&& other) noexcept;
+
     /**
      * \brief Creates a VectorDistribution and initializes it with the input \em vector.
      * @param vector Input vector.
      */
-    VectorDistribution(std::vector<T>& vector);
+    VectorDistribution(std::vector<T>& vector, const Communicator& communicator = Communicator());
+
+    /**
+     * \brief Creates a VectorDistribution of \em size elements and scatters \em vector from the process
+     * \em root with MPI_Scatterv. Only the root has to hold the input.
+     * @param size Number of elements, has to be known on every process.
+     * @param vector Input vector, only significant on the root.
+     * @param root Rank holding the input.
+     */
+    VectorDistribution(GlobalIndex size, const std::vector<T>& vector, int root,
+                       const Communicator& communicator = Communicator());
+
+    /**
+     * \brief Creates a VectorDistribution of \em size elements where the element at global index i is
+     * initialized with f(i). Every process fills its own block in parallel without communication.
+     * @param size Number of elements.
+     * @param f Generator functor taking the global index.
+     */
+    template <typename Generator,
+              typename = typename std::enable_if<std::is_invocable<Generator&, GlobalIndex>::value>::type>
+    VectorDistribution(GlobalIndex size, Generator f, const Communicator& communicator = Communicator());
+
+    /**
+     * \brief Like the generator constructor above, but with the layout \em distribution.
+     */
+    template <typename Generator,
+              typename = typename std::enable_if<std::is_invocable<Generator&, GlobalIndex>::value>::type>
+    VectorDistribution(const Distribution& distribution, Generator f, const Communicator& communicator = Communicator());
+
+    /**
+     * \brief Creates a VectorDistribution by evaluating a lazy skeleton expression.
+     * @param e Expression returned by map or zip.
+     */
+    template <typename Derived, typename R>
+    VectorDistribution(const SkeletonExpression<Derived, R>& e);
 
     /**
      * \brief Destructor.
      */
     ~VectorDistribution();
 
-    void setLocal(int localIndex, const T& value);
+    /**
+     * \brief Copies \em cs. The local block is reused if it is large enough.
+     */
+    VectorDistribution<T>& operator=(const VectorDistribution<T>& cs);
+
+    VectorDistribution<T>& operator=(VectorDistribution<T>&& other) noexcept;
+
+    /**
+     * \brief Evaluates a lazy skeleton expression into this distribution with one fused loop.
+     * The local block is only reallocated if the distribution of the expression differs.
+     * @param e Expression returned by map or zip.
+     */
+    template <typename Derived, typename R>
+    VectorDistribution<T>& operator=(const SkeletonExpression<Derived, R>& e);
+
+    void setLocal(GlobalIndex localIndex, const T& value);
+
+    T getLocal(GlobalIndex localIndex) const;
+
+    const Distribution& getDistribution() const;
+
+    const Communicator& getCommunicator() const;
+
+    /**
+     * \brief Local block of \em process if the blocks live in node-shared windows
+     * (Utils::use_shared_windows) and \em process runs on the same node, nullptr otherwise. Blocks of
+     * other processes may only be read after all processes of the node have called synchronizeNode()
+     * following their last change.
+     */
+    const T* getNodeLocalData(int process) const;
+
+    /**
+     * \brief Makes the changes of every process of the node to its block visible to the others.
+     * Collective over the node if the blocks live in a shared window, no-op otherwise.
+     */
+    void synchronizeNode() const;
+
+    /**
+     * \brief Pointer to the local block, which stores getLocalSize() elements in ascending global index
+     * order. Allows running own kernels (BLAS, SIMD, ...) on the local data without copies. The pointer
+     * stays valid until the distribution is resized, moved or destroyed.
+     */
+    T* getLocalData();
 
-    T getLocal(int localIndex);
+    const T* getLocalData() const;
+
+    GlobalIndex getLocalSize() const;
+
+    GlobalIndex getSize() const;
+
+    /**
+     * \brief Global index of the first local element. The local element i has the global index
+     * getFirstIndex() + i if the distribution is contiguous, see Distribution::globalIndex otherwise.
+     */
+    GlobalIndex getFirstIndex() const;
 
+    /**
+     * \brief Iterators over the local block.
+     */
+    T* begin();
+
+    T* end();
+
+    const T* begin() const;
+
+    const T* end() const;
+
+    /**
+     * \brief Copies the local block out of \em data, which has to hold all elements on every process.
+     */
     void scatterData(const std::vector<T>& data);
 
+    /**
+     * \brief Distributes \em data from the process \em root with MPI_Scatterv.
+     * @param data All elements, only significant on the root.
+     */
+    void scatterData(const std::vector<T>& data, int root);
+
     void gatherVectors(std::vector<T>& results);
 
+    /**
+     * \brief Starts gathering all elements into \em results on rank 0 with MPI_Igatherv and returns
+     * without waiting. \em results has to hold getSize() elements on rank 0; neither it, the local
+     * block nor this distribution may be used or changed until the returned request has completed.
+     */
+    SkeletonRequest gatherAsync(std::vector<T>& results) const;
+
+    /**
+     * \brief Like gatherAsync, but uses MPI_Iallgatherv so that every process receives all elements.
+     * \em results has to hold getSize() elements on every process.
+     */
+    SkeletonRequest allGatherAsync(std::vector<T>& results) const;
+
     void printLocal();
 
+    /**
+     * \brief Prints all elements on rank 0. The elements are streamed with gatherStream, so no process
+     * has to hold the whole vector.
+     */
     void show(const std::string& descr);
 
+    /**
+     * \brief Streams all elements in global order to \em sink on rank 0 without gathering them in one
+     * buffer. \em sink is called as sink(GlobalIndex first, const T* data, GlobalIndex count) for
+     * consecutive pieces of at most \em chunkSize elements, e.g. to write a file or compute a checksum;
+     * it may be a temporary such as a lambda written at the call. Collective.
+     *
+     * Every process sends its block in chunks with synchronous sends, the root keeps two receives per
+     * sending process in flight and waits for them in global order. Its memory stays bounded by four
+     * chunks for contiguous distributions and two chunks per process for BLOCK_CYCLIC.
+     * @param chunkSize Elements per message, between 1 and INT_MAX.
+     */
+    template <typename Sink>
+    void gatherStream(Sink&& sink, GlobalIndex chunkSize = 1 << 16) const;
+
+    /**
+     * \brief Reads the vector file \em path (see VectorFileHeader), every process only its own block.
+     * The distribution is kept if it has the size of the file, otherwise the file is distributed in
+     * balanced blocks. Needs a contiguous distribution and trivially copyable elements. Collective;
+     * throws std::runtime_error on every process if the file cannot be read.
+     * @param access COLLECTIVE_IO reads with MPI_File_read_at_all, MAPPED_IO maps the block with mmap
+     * and needs all processes on one node.
+     */
+    void readFile(const std::string& path, FileAccess access = COLLECTIVE_IO);
+
+    /**
+     * \brief Writes all elements to the vector file \em path, every process its own block. An existing
+     * file is replaced. Collective, same requirements as readFile.
+     */
+    void writeFile(const std::string& path, FileAccess access = COLLECTIVE_IO) const;
+
+    /**
+     * \brief Lazily applies \em f to every element. Nothing is computed until the returned expression
+     * is reduced, gathered or assigned to a VectorDistribution.
+     */
     template <typename R, typename MapFunctor>
-    VectorDistribution<R> map(MapFunctor &f);
+    MapExpression<R, DistributionTerminal<T>, MapFunctor> map(MapFunctor &f) const;
+
+    /**
+     * \brief Applies \em f to every element and writes the results into \em out, which is only
+     * reallocated if its distribution differs. \em out may be this distribution.
+     */
+    template <typename R, typename MapFunctor>
+    void map(MapFunctor &f, VectorDistribution<R>& out) const;
+
+    /**
+     * \brief Replaces every element by the result of \em f.
+     */
+    template <typename MapFunctor>
+    void mapInPlace(MapFunctor &f);
+
+    /**
+     * \brief Lazily applies \em f to every element together with its global index; \em f is called
+     * as R f(GlobalIndex, T) const.
+     */
+    template <typename R, typename MapFunctor>
+    MapIndexExpression<R, DistributionTerminal<T>, MapFunctor> mapIndex(MapFunctor &f) const;
+
+    /**
+     * \brief Applies \em f to every element and its global index and writes the results into \em out,
+     * which is only reallocated if its distribution differs. \em out may be this distribution.
+     */
+    template <typename R, typename MapFunctor>
+    void mapIndex(MapFunctor &f, VectorDistribution<R>& out) const;
+
+    /**
+     * \brief Replaces every element x at global index i by f(i, x).
+     */
+    template <typename MapFunctor>
+    void mapIndexInPlace(MapFunctor &f);
+
+    /**
+     * \brief Applies the stencil \em f to every element and writes the results into \em out, which is
+     * only reallocated if its distribution differs and has to be another distribution than this one.
+     * \em f is called as R f(const Neighborhood<T>&) const and may read the neighbors up to \em radius.
+     * The halos are exchanged with the neighboring processes by non-blocking messages while the
+     * interior of the block is updated.
+     *
+     * Needs a contiguous distribution in which every process holds at least \em radius elements,
+     * otherwise std::invalid_argument is thrown.
+     * @param mode Values beyond the first and last element, see BoundaryMode.
+     * @param boundary Value beyond both ends for FIXED.
+     */
+    template <typename R, typename StencilFunctor>
+    void mapStencil(GlobalIndex radius, StencilFunctor& f, VectorDistribution<R>& out,
+                    BoundaryMode mode = CLAMPED, const T& boundary = T()) const;
+
+    template <typename R, typename StencilFunctor>
+    VectorDistribution<R> mapStencil(GlobalIndex radius, StencilFunctor& f,
+                                     BoundaryMode mode = CLAMPED, const T& boundary = T()) const;
+
+    /**
+     * \brief Inclusive prefix sum with the associative functor \em f: element i of the result is the
+     * combination of the elements 0..i. The neutral element is taken from ReduceIdentity as in reduce;
+     * if none is known, element 0 is copied and the combination starts from it.
+     * Needs a contiguous distribution, otherwise std::invalid_argument is thrown.
+     */
+    template <typename ScanFunctor>
+    VectorDistribution<T> scan(ScanFunctor &f) const;
+
+    template <typename ScanFunctor>
+    void scanInPlace(ScanFunctor &f);
+
+    /**
+     * \brief Exclusive prefix sum: element i of the result is the combination of the elements 0..i-1,
+     * element 0 is \em identity, the neutral element of \em f.
+     */
+    template <typename ScanFunctor>
+    VectorDistribution<T> exscan(ScanFunctor &f, const T& identity) const;
+
+    template <typename ScanFunctor>
+    void exscanInPlace(ScanFunctor &f, const T& identity);
+
+    /**
+     * \brief Sorts all elements with the strict weak ordering \em comp (e.g. std::less<T>) by sample
+     * sort: every process sorts its block with all threads, cuts it at splitters sampled from all blocks,
+     * exchanges the buckets with MPI_Alltoallv and merges the received runs. The sorted elements are
+     * finally moved back into the layout of the vector, or into balanced blocks if it is not contiguous.
+     * Equal elements may end up in any order.
+     */
+    template <typename Comparator>
+    VectorDistribution<T> sort(Comparator &comp) const;
+
+    template <typename Comparator>
+    void sortInPlace(Comparator &comp);
+
+    /**
+     * \brief Returns the elements for which \em f returns true, in their order. Every process compacts its
+     * own block in parallel (per-thread counts and a scan over the threads), so the result keeps the kept
+     * elements where they are and has blocks of irregular size (Distribution::irregularBlock). \em f is
+     * called twice per element and has to return the same value both times. Needs a contiguous
+     * distribution, otherwise std::invalid_argument is thrown.
+     */
+    template <typename Predicate>
+    VectorDistribution<T> filter(Predicate &f) const;
+
+    /**
+     * \brief Moves the elements into the contiguous layout \em target with the same size. Only processes
+     * whose old and new blocks overlap exchange messages, the part a process keeps is copied locally.
+     */
+    void redistribute(const Distribution& target);
+
+    /**
+     * \brief Restores balanced blocks, e.g. after filter.
+     */
+    void rebalance();
+
+    /**
+     * \brief Groups the elements by keyFn(x) and combines valueFn(x) of every group with \em combine,
+     * which has to be associative and commutative. Every thread pre-aggregates its chunk in its own hash
+     * tables, so only one partial value per distinct key and process is sent; the partials are exchanged
+     * by key hash with MPI_Alltoallv. Every process returns the groups it owns, in no particular order,
+     * as irregular blocks of the result.
+     *
+     * @tparam K Key type, needs std::hash and operator==.
+     * @tparam V Value type.
+     */
+    template <typename K, typename V, typename KeyFunctor, typename ValueFunctor, typename ReduceFunctor>
+    VectorDistribution<KeyValue<K, V>> reduceByKey(KeyFunctor &keyFn, ValueFunctor &valueFn, ReduceFunctor &combine) const;
+
+    /**
+     * \brief Counts the elements per bin, \em bin maps an element to its bin in [0, numBins); elements
+     * mapped outside are ignored. Every thread counts into its own array, the arrays are summed and the
+     * counts of all processes combined with MPI_Reduce_scatter, so every process receives its balanced
+     * block of the numBins counts.
+     */
+    template <typename BinFunctor>
+    VectorDistribution<GlobalIndex> histogram(BinFunctor &bin, GlobalIndex numBins) const;
+
+    /**
+     * \brief Histogram of \em numBins bins of equal width over [min, max) for arithmetic element types.
+     */
+    VectorDistribution<GlobalIndex> histogram(const T& min, const T& max, GlobalIndex numBins) const;
+
+    /**
+     * \brief Reduces all elements with the associative functor \em f. The partial results of the processes
+     * are combined with MPI_Reduce, so the result is only valid on rank 0.
+     * The neutral element is taken from ReduceIdentity; if none is known, every fold starts from its
+     * first element and the result of an empty vector is T(). With a BLOCK_CYCLIC
+     * distribution the elements are not folded in global order, so \em f has to be commutative as well.
+     */
+    template <typename ReduceFunctor>
+    T reduce(ReduceFunctor &f) const;
+
+    /**
+     * \brief Reduces all elements with the associative functor \em f starting from its neutral element
+     * \em identity. The result is only valid on rank 0.
+     */
+    template <typename ReduceFunctor>
+    T reduce(ReduceFunctor &f, const T& identity) const;
+
+    /**
+     * \brief Like reduce, but uses MPI_Allreduce so that every process receives the result.
+     */
+    template <typename ReduceFunctor>
+    T allReduce(ReduceFunctor &f) const;
+
+    template <typename ReduceFunctor>
+    T allReduce(ReduceFunctor &f, const T& identity) const;
+
+    /**
+     * \brief Folds the local block and starts combining the partial results with MPI_Iallreduce. The
+     * returned future yields the result on every process; \em f has to outlive its completion.
+     */
+    template <typename ReduceFunctor>
+    SkeletonFuture<T> reduceAsync(ReduceFunctor &f) const;
 
     template <typename ReduceFunctor>
-    T reduce(ReduceFunctor &f);
+    SkeletonFuture<T> reduceAsync(ReduceFunctor &f, const T& identity) const;
 
-    template <typename R, typename T2, typename ZipFunctor>
-    VectorDistribution<R> zip(VectorDistribution<T2>& b, ZipFunctor& f);
+    /**
+     * \brief Reduces all elements with the functor, identity and collective prepared in \em plan,
+     * without allocating anything. Meant for reductions which are repeated many times.
+     */
+    template <typename ReduceFunctor>
+    T reduce(ReducePlan<T, ReduceFunctor>& plan) const;
+
+    /**
+     * \brief Lazily combines this distribution with \em b, which is either a VectorDistribution of the
+     * same size or a lazy expression over one.
+     */
+    template <typename R, typename Other, typename ZipFunctor>
+    ZipExpression<R, DistributionTerminal<T>, typename ExpressionOf<Other>::type, ZipFunctor>
+    zip(const Other& b, ZipFunctor& f) const;
+
+    /**
+     * \brief Combines this distribution with \em b and writes the results into \em out, which is only
+     * reallocated if its distribution differs. \em out may be one of the operands.
+     */
+    template <typename R, typename Other, typename ZipFunctor>
+    void zip(const Other& b, ZipFunctor& f, VectorDistribution<R>& out) const;
+
+    /**
+     * \brief Replaces every element by the result of \em f applied to it and the element of \em b.
+     */
+    template <typename Other, typename ZipFunctor>
+    void zipInPlace(const Other& b, ZipFunctor& f);
+
+    /**
+     * \brief Like zip, but \em f is called as R f(GlobalIndex, T, T2) const with the global index of
+     * the elements.
+     */
+    template <typename R, typename Other, typename ZipFunctor>
+    ZipIndexExpression<R, DistributionTerminal<T>, typename ExpressionOf<Other>::type, ZipFunctor>
+    zipIndex(const Other& b, ZipFunctor& f) const;
+
+    template <typename R, typename Other, typename ZipFunctor>
+    void zipIndex(const Other& b, ZipFunctor& f, VectorDistribution<R>& out) const;
 
 private:
+    template <typename U>
+    friend class GatherPlan;
+
     // number of MPI processes
     int numProcesses;
     // position of processor
     int rank;
     // number of elements
-    int vectorSize;
+    GlobalIndex vectorSize;
     // number of local elements
-    int localSize;
-    // remaining size for last process
-    int remainingSize;
+    GlobalIndex localSize;
     // start of global index
-    int firstIndex;
+    GlobalIndex firstIndex;
+    // layout of the elements over the processes
+    Distribution distribution;
+    // processes the elements are distributed over
+    Communicator communicator;
+    // block sizes and offsets of all processes for the collectives, empty above INT_MAX elements
+    std::vector<int> blockCounts;
+    std::vector<int> blockDisplacements;
 
-    std::vector<T> localVector;
+    // local block, aligned and not value-initialized, see LocalAllocator
+    std::vector<T, LocalAllocator<T>> localVector;
+    // node-shared memory holding the local block instead of localVector, see Utils::use_shared_windows
+    std::unique_ptr<SharedWindow> window;
+    // first local element, in localVector or in the window
+    T* localData;
+    // halos and edge copies of mapStencil, kept between calls
+    mutable std::vector<T> stencilBuffer;
 
+    // takes the layout from distribution and communicator and allocates the local block without touching it
     void init();
 
-    void gatherEqualVectors(std::vector<T> &results);
+    // initializes the local block with T() in a schedule(static) loop to place its pages (first touch)
+    void firstTouch();
+
+    // copies the local block of \em cs, which has the same distribution, in a schedule(static) loop
+    void copyLocal(const VectorDistribution<T>& cs);
+
+    // gather/scatter the local blocks in block order (see Distribution) to/from \em buffer on the root
+    void gatherBlocks(T* buffer);
+
+    void gatherEqualVectors(T* buffer);
+
+    void gatherUnequalVectors(T* buffer);
+
+    void gatherLargeVectors(T* buffer);
+
+    // reads the blocks of the node from the window on its leader, only leaders communicate
+    void gatherNodeBlocks(T* buffer);
+
+    // prefix sum of the local block into \em out (may be the local block): every thread folds its chunk,
+    // the chunk offsets are combined in thread order and with MPI_Exscan, then every chunk is scanned;
+    // a null \em identity stands for the one from ReduceIdentity or, if none is known, for starting
+    // from the first element
+    template <typename ScanFunctor>
+    void scanBlock(ScanFunctor& f, const T* identity, bool exclusive, T* out) const;
+
+    // starts gathering the local blocks in global order to rank 0 or to every process
+    SkeletonRequest gatherVectorsAsync(std::vector<T>& results, bool all) const;
+
+    // copies the blocks of \em layout from block order in \em blocks to global order in \em results
+    static void restoreGlobalOrder(const Distribution& layout, const T* blocks, T* results);
+
+    void scatterBlocks(const T* buffer, int root);
+
+    void scatterLargeData(const T* buffer, int root);
+
+    // reads or writes the local block at the byte offset of the file
+    void transferFileBlock(MPI_File file, MPI_Offset offset, bool write) const;
 
-    void gatherUnequalVectors(std::vector<T> &results);
+    // throws unless MAPPED_IO can be used for \em skeleton
+    void requireMappedAccess(const char* skeleton) const;
 };
 
 #include "../src/VectorDistribution.cpp"
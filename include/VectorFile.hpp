@@ -0,0 +1,99 @@
+#ifndef MPI_OPENMP_VECTORFILE_HPP
+#define MPI_OPENMP_VECTORFILE_HPP
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <mpi.h>
+
+#include "Utils.hpp"
+#include "Communicator.hpp"
+
+/**
+ * \brief How readFile and writeFile access the file.
+ */
+enum FileAccess {
+    // collective MPI-IO at the offset of every block, works on parallel file systems across nodes
+    COLLECTIVE_IO,
+    // every process maps its block with mmap and copies it with all threads, all processes on one node
+    MAPPED_IO
+};
+
+/**
+ * \brief Struct VectorFileHeader starts a distributed vector file. The header is followed by the
+ * elements in global order, starting at dataOffset. Files are written in the byte order of the
+ * machine.
+ */
+struct VectorFileHeader {
+    char magic[8]; // "SKELVEC" and a terminating zero
+    std::uint32_t version;
+    std::uint32_t elementSize; // sizeof(T) of the writer
+    std::int64_t size; // number of elements
+    std::int64_t dataOffset; // byte offset of the first element
+    char reserved[32];
+};
+
+static_assert(sizeof(VectorFileHeader) == 64, "VectorFileHeader has to be 64 bytes");
+
+/**
+ * \brief Header of a file holding \em size elements of \em elementSize bytes.
+ */
+VectorFileHeader makeVectorFileHeader(GlobalIndex size, std::size_t elementSize);
+
+/**
+ * \brief Reads the header of \em path on rank 0 and broadcasts it. Collective; throws
+ * std::runtime_error on every process if the file cannot be read, is no vector file, holds elements
+ * of another size than \em elementSize or is shorter than the header claims.
+ */
+VectorFileHeader readVectorFileHeader(const std::string& path, std::size_t elementSize,
+                                      const Communicator& communicator);
+
+/**
+ * \brief Creates (or truncates) \em path with the size of the data described by \em header and writes
+ * the header. Not collective, returns false if the file cannot be created.
+ */
+bool createVectorFile(const std::string& path, const VectorFileHeader& header);
+
+/**
+ * \brief Opens \em path with MPI_File_open, throws std::runtime_error on every process if it fails.
+ */
+MPI_File openVectorFile(const std::string& path, int mode, const Communicator& communicator);
+
+/**
+ * \brief Class MappedFile maps the byte range [offset, offset + bytes) of a file into memory. The
+ * mapping starts at the page boundary below \em offset and is removed on destruction.
+ */
+class MappedFile {
+public:
+    /**
+     * @param writable Map the range shared and writable, the file has to be large enough.
+     */
+    MappedFile(const std::string& path, std::int64_t offset, std::size_t bytes, bool writable);
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    /**
+     * \brief Whether the range could be mapped.
+     */
+    bool isValid() const { return bytes == 0 || base != nullptr; }
+
+    void* getData() const { return static_cast<char*>(base) + shift; }
+
+    /**
+     * \brief Writes the modified pages back to the file.
+     */
+    bool sync();
+
+private:
+    void* base;
+    std::size_t length;
+    std::size_t shift;
+    std::size_t bytes;
+};
+
+#endif //MPI_OPENMP_VECTORFILE_HPP
@@ -1,6 +1,9 @@
 #ifndef MPI_OPENMP_FUNCTORS_HPP
 #define MPI_OPENMP_FUNCTORS_HPP
 
+#include <functional>
+#include <type_traits>
+
 /**
  * \brief Class MapFunctor represents a functor for the map skeleton of a distributed vector.
  *
@@ -72,4 +75,225 @@ public:
     virtual ~ZipFunctor() {}
 };
 
+/*
+ * The skeletons are templates over the concrete functor type and store functors by value, so calls
+ * are resolved at compile time and can be inlined. The virtual base classes above remain usable, the
+ * classes below avoid the virtual table altogether and check the signature at compile time.
+ */
+
+/**
+ * \brief Struct IsMapFunctor checks whether \em F can be called as R f(T) const.
+ */
+template <typename F, typename T, typename R>
+struct IsMapFunctor : std::is_invocable_r<R, const F&, T> {};
+
+/**
+ * \brief Struct IsZipFunctor checks whether \em F can be called as R f(T1, T2) const.
+ */
+template <typename F, typename T1, typename T2, typename R>
+struct IsZipFunctor : std::is_invocable_r<R, const F&, T1, T2> {};
+
+/**
+ * \brief Struct IsReduceFunctor checks whether \em F can be called as T f(T, T) const.
+ */
+template <typename F, typename T>
+struct IsReduceFunctor : std::is_invocable_r<T, const F&, T, T> {};
+
+/**
+ * \brief Struct IsCompareFunctor checks whether \em F can be called as bool f(T, T) const, a strict weak
+ * ordering like std::less.
+ */
+template <typename F, typename T>
+struct IsCompareFunctor : std::is_invocable_r<bool, const F&, T, T> {};
+
+template <typename F, typename = void>
+struct HasCommutativeFlag : std::false_type {};
+
+template <typename F>
+struct HasCommutativeFlag<F, std::void_t<decltype(F::commutative)>> : std::true_type {};
+
+template <typename F, typename = void>
+struct HasIdentity : std::false_type {};
+
+template <typename F>
+struct HasIdentity<F, std::void_t<decltype(F::identity())>> : std::true_type {};
+
+/**
+ * \brief Struct IsBuiltinCommutative marks the commutative function objects of the standard library.
+ */
+template <typename F>
+struct IsBuiltinCommutative : std::false_type {};
+
+template <typename X> struct IsBuiltinCommutative<std::plus<X>> : std::true_type {};
+template <typename X> struct IsBuiltinCommutative<std::multiplies<X>> : std::true_type {};
+template <typename X> struct IsBuiltinCommutative<std::logical_and<X>> : std::true_type {};
+template <typename X> struct IsBuiltinCommutative<std::logical_or<X>> : std::true_type {};
+template <typename X> struct IsBuiltinCommutative<std::bit_and<X>> : std::true_type {};
+template <typename X> struct IsBuiltinCommutative<std::bit_or<X>> : std::true_type {};
+template <typename X> struct IsBuiltinCommutative<std::bit_xor<X>> : std::true_type {};
+
+template <typename F, bool = HasCommutativeFlag<F>::value>
+struct CommutativeFlag : std::integral_constant<bool, IsBuiltinCommutative<F>::value> {};
+
+template <typename F>
+struct CommutativeFlag<F, true> : std::integral_constant<bool, F::commutative> {};
+
+/**
+ * \brief Struct ReduceIdentity provides the neutral element of a reduce functor: F::identity() if the
+ * functor declares one and the matching value for the standard library function objects. For other
+ * functors \em known is false; the skeletons then start every fold from its first element instead.
+ */
+template <typename F, typename T, bool = HasIdentity<F>::value>
+struct ReduceIdentity {
+    // T() is neutral for the remaining standard library function objects (plus, logical_or, bit_or, bit_xor)
+    static const bool known = IsBuiltinCommutative<F>::value;
+
+    static T get() { return T(); }
+};
+
+template <typename F, typename T>
+struct ReduceIdentity<F, T, true> {
+    static const bool known = true;
+
+    static T get() { return F::identity(); }
+};
+
+template <typename X, typename T>
+struct ReduceIdentity<std::multiplies<X>, T, false> {
+    static const bool known = true;
+
+    static T get() { return T(1); }
+};
+
+template <typename X, typename T>
+struct ReduceIdentity<std::logical_and<X>, T, false> {
+    static const bool known = true;
+
+    static T get() { return T(true); }
+};
+
+template <typename X, typename T>
+struct ReduceIdentity<std::bit_and<X>, T, false> {
+    static const bool known = true;
+
+    static T get() { return T(~T()); }
+};
+
+/**
+ * \brief Struct FunctorTraits collects the compile-time properties of a functor used by the skeletons.
+ * A reduce functor declares itself commutative with a static constexpr bool member \em commutative,
+ * which allows reordering the fold (e.g. SIMD lanes) and lets MPI combine partial results in any order.
+ */
+template <typename F>
+struct FunctorTraits {
+    static constexpr bool commutative = CommutativeFlag<typename std::remove_const<F>::type>::value;
+};
+
+/**
+ * \brief Struct OptionalValue is a partial result which may be empty, e.g. the fold of an empty block
+ * with a reduce functor whose neutral element is not known.
+ */
+template <typename T>
+struct OptionalValue {
+    T value;
+    bool valid;
+};
+
+/**
+ * \brief Struct SkipEmpty combines OptionalValues with the reduce functor \em f; an empty operand
+ * yields the other one, so empty partial results need no neutral element.
+ */
+template <typename F>
+struct SkipEmpty {
+    static constexpr bool commutative = FunctorTraits<F>::commutative;
+
+    F& f;
+
+    template <typename T>
+    OptionalValue<T> operator()(const OptionalValue<T>& a, const OptionalValue<T>& b) const {
+        if (!a.valid)
+            return b;
+        if (!b.valid)
+            return a;
+        return {f(a.value, b.value), true};
+    }
+};
+
+/**
+ * \brief Selects how a skeleton stores a functor: by value, so that calls are resolved statically, or by
+ * reference for abstract (virtual) functor types passed through a base class reference.
+ */
+template <typename F>
+struct FunctorStorage {
+    typedef typename std::remove_const<F>::type Functor;
+    typedef typename std::conditional<std::is_abstract<Functor>::value,
+                                      std::reference_wrapper<const Functor>,
+                                      Functor>::type type;
+};
+
+/**
+ * \brief Class StaticMapFunctor is a non-virtual base for map functors (CRTP). Deriving from it checks
+ * at compile time that \em Derived provides R operator()(T) const.
+ *
+ * @tparam Derived The functor class.
+ * @tparam T Input data type.
+ * @tparam R Output data type.
+ */
+template <typename Derived, typename T, typename R>
+class StaticMapFunctor {
+public:
+    typedef T argument_type;
+    typedef R result_type;
+
+protected:
+    StaticMapFunctor() {
+        static_assert(IsMapFunctor<Derived, T, R>::value, "map functor has to provide R operator()(T) const");
+    }
+};
+
+/**
+ * \brief Class StaticReduceFunctor is a non-virtual base for reduce functors (CRTP). Deriving from it checks
+ * at compile time that \em Derived provides T operator()(T, T) const. The functor has to be associative.
+ *
+ * @tparam Derived The functor class.
+ * @tparam T Data type.
+ * @tparam Commutative Whether the operands may be swapped.
+ */
+template <typename Derived, typename T, bool Commutative = false>
+class StaticReduceFunctor {
+public:
+    typedef T argument_type;
+    typedef T result_type;
+
+    static constexpr bool associative = true;
+    static constexpr bool commutative = Commutative;
+
+protected:
+    StaticReduceFunctor() {
+        static_assert(IsReduceFunctor<Derived, T>::value, "reduce functor has to provide T operator()(T, T) const");
+    }
+};
+
+/**
+ * \brief Class StaticZipFunctor is a non-virtual base for zip functors (CRTP). Deriving from it checks
+ * at compile time that \em Derived provides R operator()(T, T2) const.
+ *
+ * @tparam Derived The functor class.
+ * @tparam T Input data type of the first distributed vector.
+ * @tparam R Output data type.
+ * @tparam T2 Input data type of the second distributed vector.
+ */
+template <typename Derived, typename T, typename R, typename T2 = T>
+class StaticZipFunctor {
+public:
+    typedef T first_argument_type;
+    typedef T2 second_argument_type;
+    typedef R result_type;
+
+protected:
+    StaticZipFunctor() {
+        static_assert(IsZipFunctor<Derived, T, T2, R>::value, "zip functor has to provide R operator()(T, T2) const");
+    }
+};
+
 #endif //MPI_OPENMP_FUNCTORS_HPP
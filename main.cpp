@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include "omp.h"
 #include <unistd.h>
@@ -7,29 +8,31 @@
 #include "VectorDistribution.hpp"
 #include "Utils.hpp"
 
-double getAvg(double t)
+// a skeleton is only finished when its slowest process is, so every timing is the maximum over the ranks
+double getMax(double t)
 {
-    double sum;
-    MPI_Allreduce(&t, &sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-    return sum/Utils::num_procs;
+    double max;
+    MPI_Allreduce(&t, &max, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    return max;
 }
 
 int main(int argc, char** argv) {
     initSkeletons(argc, argv);
 
     int iterations = 5;
-    int size = 10;
+    GlobalIndex size = 10;
     int threads = 1;
     int perform = 1;
+    int warmups = 4;
     int c;
 
-    while ((c = getopt(argc, argv, "n:s:t:p:")) != -1) {
+    while ((c = getopt(argc, argv, "n:s:t:p:u:w")) != -1) {
         switch (c) {
             case 'n':
                 iterations = atoi(optarg);
                 break;
             case 's':
-                size = atoi(optarg);
+                size = atoll(optarg);
                 break;
             case 't':
                 threads = atoi(optarg);
@@ -37,6 +40,13 @@ int main(int argc, char** argv) {
             case 'p':
                 perform = atoi(optarg);
                 break;
+            case 'u':
+                warmups = atoi(optarg);
+                break;
+            case 'w':
+                // local blocks in node-shared memory, hierarchical gathers and reductions
+                Utils::use_shared_windows = true;
+                break;
             case '?':
                 return 1;
             default:
@@ -45,30 +55,24 @@ int main(int argc, char** argv) {
     }
     // Set number of threads
     omp_set_num_threads(threads);
+    // at least one run is measured
+    warmups = std::max(0, std::min(warmups, iterations - 1));
 
     // Start
     double startTime, mapTime, reduceTime, zipTime;
     mapTime = reduceTime = zipTime = 0;
+    startTime = MPI_Wtime();
 
     for (int run = 0; run < iterations; run++) {
         // Create data structures
-        // Input data
-        std::vector<int> input1(size);
-        std::vector<int> input2(size);
-
-        // Fill input vectors
-        for (int i = 0; i < size; i++) {
-            input1[i] = i + 1;
-            input2[i] = (i + 1) * (i + 1);
-        }
-
-        VectorDistribution<int> inputVD1(input1);
-        VectorDistribution<int> inputVD2(input2);
+        // Input data, every process only generates its own block
+        VectorDistribution<int> inputVD1(size, [] (GlobalIndex i) {return (int)(i + 1);});
+        VectorDistribution<int> inputVD2(size, [] (GlobalIndex i) {return (int)((i + 1) * (i + 1));});
 
         // Output
         VectorDistribution<int> outputMap;
         VectorDistribution<int> outputZip;
-        int outReduce;
+        volatile int outReduce;
 
         // Functions
         auto mapFunction = [] (int val) {return val + val;};
@@ -79,49 +83,52 @@ int main(int argc, char** argv) {
         //
         // MAP FUNCTION
         //
+        MPI_Barrier(MPI_COMM_WORLD);
         double t = MPI_Wtime();
         for (int p = 0; p < perform; ++p)
             outputMap = inputVD1.map<int>(mapFunction);
 
         // Timing
-        mapTime += MPI_Wtime() - t;
-        mapTime = getAvg(mapTime);
+        mapTime += getMax(MPI_Wtime() - t);
 
         //
         // ZIP FUNCTION
         //
+        MPI_Barrier(MPI_COMM_WORLD);
         t = MPI_Wtime();
         for (int p = 0; p < perform; ++p)
             outputZip = inputVD1.zip<int>(inputVD2, zipFunction);
 
         // Timing
-        zipTime += MPI_Wtime() - t;
-        zipTime = getAvg(zipTime);
+        zipTime += getMax(MPI_Wtime() - t);
 
         //
         // REDUCE FUNCTION
         //
+        // the plan keeps partials and MPI operation across the repetitions
+        ReducePlan<int, decltype(reduceFunction)> reducePlan(reduceFunction, 0, false);
+        MPI_Barrier(MPI_COMM_WORLD);
         t = MPI_Wtime();
         for (int p = 0; p < perform; ++p)
-            outReduce = inputVD1.reduce(reduceFunction);
+            outReduce = inputVD1.reduce(reducePlan);
 
         // Timing
-        reduceTime += MPI_Wtime() - t;
-        reduceTime = getAvg(reduceTime);
+        reduceTime += getMax(MPI_Wtime() - t);
+        (void)outReduce; // volatile, so that the timed reduction is not optimized away
 
-        if (run < 4) {
+        if (run < warmups) {
             mapTime = reduceTime = zipTime = 0; // Warm up
             startTime = MPI_Wtime();
         }
     }
 
     if (Utils::proc_rank == 0) {
-        int divIter = iterations - 4;
-        printf("Map;%i;%f;%i\n", size, mapTime / divIter, threads);
-        printf("Zip;%i;%f;%i\n", size, zipTime / divIter, threads);
-        printf("Red;%i;%f;%i\n", size, reduceTime / divIter, threads);
+        int divIter = iterations - warmups;
+        printf("Map;%lld;%f;%i\n", (long long)size, mapTime / divIter, threads);
+        printf("Zip;%lld;%f;%i\n", (long long)size, zipTime / divIter, threads);
+        printf("Red;%lld;%f;%i\n", (long long)size, reduceTime / divIter, threads);
         double totalTime = MPI_Wtime() - startTime;
-        printf("Time/runs;%i;%f;%i\n", size, totalTime / divIter, threads);
+        printf("Time/runs;%lld;%f;%i\n", (long long)size, totalTime / divIter, threads);
     }
 
     // Terminate the MPI Environment
@@ -1,4 +1,5 @@
 #include "functors.hpp"
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <unistd.h>
@@ -36,11 +37,10 @@ std::vector<R> map(std::vector<T>& vector, Functor& f) {
 }
 
 template <typename T, typename Functor>
-T reduce(std::vector<T>& vector, Functor& f) {
+T reduce(const std::vector<T>& vector, Functor& f) {
     T result = vector.front();
-    vector.erase(vector.begin());
 
-    for (size_t i = 0; i < vector.size(); i++) {
+    for (size_t i = 1; i < vector.size(); i++) {
         result = f(result, vector[i]);
     }
 
@@ -72,9 +72,10 @@ int main(int argc, char** argv) {
     int iterations = 5;
     int size = 10;
     int perform = 1;
+    int warmups = 4;
     int c;
 
-    while ((c = getopt(argc, argv, "n:s:p:")) != -1) {
+    while ((c = getopt(argc, argv, "n:s:p:u:")) != -1) {
         switch (c) {
             case 'n':
                 iterations = atoi(optarg);
@@ -85,12 +86,18 @@ int main(int argc, char** argv) {
             case 'p':
                 perform = atoi(optarg);
                 break;
+            case 'u':
+                warmups = atoi(optarg);
+                break;
             case '?':
                 return 1;
             default:
                 abort();
         }
     }
+    // at least one run is measured
+    warmups = std::max(0, std::min(warmups, iterations - 1));
+
     // Start
     double startTime, mapTime, reduceTime, zipTime;
     mapTime = reduceTime = zipTime = 0;
@@ -111,7 +118,7 @@ int main(int argc, char** argv) {
         // Output
         std::vector<int> outputMap(size);
         std::vector<int> outputZip(size);
-        int outReduce;
+        volatile int outReduce;
 
         // Functions
         auto mapFunction = [] (int val) {return val + val;};
@@ -147,14 +154,15 @@ int main(int argc, char** argv) {
 
         // Timing
         reduceTime += MPI_Wtime() - t;
+        (void)outReduce; // volatile, so that the timed reduction is not optimized away
 
-        if (run < 4) {
+        if (run < warmups) {
             mapTime = reduceTime = zipTime = 0; // Warm up
             startTime = MPI_Wtime();
         }
     }
 
-    int divIter = iterations - 4;
+    int divIter = iterations - warmups;
     printf("Map;%i;%f\n", size, mapTime / divIter);
     printf("Zip;%i;%f\n", size, zipTime / divIter);
     printf("Red;%i;%f\n", size, reduceTime / divIter);
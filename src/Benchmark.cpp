@@ -0,0 +1,113 @@
+#include "Benchmark.hpp"
+#include "LocalAllocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+BenchmarkStatistics computeStatistics(std::vector<double> samples) {
+    if (samples.empty())
+        throw std::invalid_argument("computeStatistics: no samples");
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples] (double p) {
+        double position = p * (double)(samples.size() - 1);
+        size_t lower = (size_t)position;
+        size_t upper = std::min(lower + 1, samples.size() - 1);
+        return samples[lower] + (position - (double)lower) * (samples[upper] - samples[lower]);
+    };
+
+    double sum = 0;
+    for (double s : samples) {
+        sum += s;
+    }
+
+    BenchmarkStatistics statistics;
+    statistics.min = samples.front();
+    statistics.p10 = percentile(0.1);
+    statistics.median = percentile(0.5);
+    statistics.p90 = percentile(0.9);
+    statistics.max = samples.back();
+    statistics.mean = sum / (double)samples.size();
+    return statistics;
+}
+
+double BenchmarkResult::bandwidth() const {
+    return time.median > 0 ? bytes / time.median * 1e-9 : 0;
+}
+
+Benchmark::Benchmark(int warmups, int repetitions, const Communicator& communicator)
+    : warmups(warmups), repetitions(repetitions), communicator(communicator) {
+    if (warmups < 0 || repetitions < 1)
+        throw std::invalid_argument("Benchmark: needs at least one repetition and no negative warm-ups");
+}
+
+BenchmarkStatistics Benchmark::slowestProcess(std::vector<double>& times) const {
+    MPI_Allreduce(MPI_IN_PLACE, times.data(), (int)times.size(), MPI_DOUBLE, MPI_MAX, communicator.get());
+    return computeStatistics(times);
+}
+
+double Benchmark::streamTriad(GlobalIndex elementsPerProcess) {
+    // LocalAllocator leaves the pages untouched, so they are placed by the loop below
+    std::vector<double, LocalAllocator<double>> a(elementsPerProcess), b(elementsPerProcess), c(elementsPerProcess);
+    double* pa = a.data();
+    double* pb = b.data();
+    double* pc = c.data();
+    const double scalar = 3.0;
+
+    // first touch with the same static schedule as the timed loop
+    #pragma omp parallel for schedule(static)
+    for (GlobalIndex i = 0; i < elementsPerProcess; i++) {
+        pa[i] = 0.0;
+        pb[i] = 1.0;
+        pc[i] = 2.0;
+    }
+
+    BenchmarkStatistics time = measure([=] () {
+        #pragma omp parallel for schedule(static)
+        for (GlobalIndex i = 0; i < elementsPerProcess; i++) {
+            pa[i] = pb[i] + scalar * pc[i];
+        }
+    });
+
+    double bytes = 3.0 * sizeof(double) * (double)elementsPerProcess * communicator.getSize();
+    return time.median > 0 ? bytes / time.median * 1e-9 : 0;
+}
+
+void Benchmark::add(const BenchmarkResult& result) {
+    results.push_back(result);
+}
+
+double Benchmark::baselineOf(const std::vector<double>& baseline, int threads) {
+    return threads >= 0 && threads < (int)baseline.size() ? baseline[threads] : 0;
+}
+
+void Benchmark::writeCsv(std::ostream& out, const std::vector<double>& baseline) const {
+    out << "skeleton,type,mode,size,processes,threads,repetitions,"
+           "min,p10,median,p90,max,mean,gbs,stream_gbs,stream_fraction\n";
+    for (const BenchmarkResult& r : results) {
+        double stream = baselineOf(baseline, r.threads);
+        out << r.skeleton << ',' << r.type << ',' << r.mode << ',' << r.size << ',' << r.processes << ','
+            << r.threads << ',' << r.repetitions << ',' << r.time.min << ',' << r.time.p10 << ','
+            << r.time.median << ',' << r.time.p90 << ',' << r.time.max << ',' << r.time.mean << ','
+            << r.bandwidth() << ',' << stream << ',' << (stream > 0 ? r.bandwidth() / stream : 0) << '\n';
+    }
+}
+
+void Benchmark::writeJson(std::ostream& out, const std::vector<double>& baseline) const {
+    out << "{\n  \"warmups\": " << warmups << ",\n  \"repetitions\": " << repetitions << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& r = results[i];
+        double stream = baselineOf(baseline, r.threads);
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"skeleton\": \"" << r.skeleton << "\", \"type\": \"" << r.type
+            << "\", \"mode\": \"" << r.mode << "\", \"size\": " << r.size
+            << ", \"processes\": " << r.processes << ", \"threads\": " << r.threads
+            << ", \"repetitions\": " << r.repetitions
+            << ", \"time\": {\"min\": " << r.time.min << ", \"p10\": " << r.time.p10
+            << ", \"median\": " << r.time.median << ", \"p90\": " << r.time.p90
+            << ", \"max\": " << r.time.max << ", \"mean\": " << r.time.mean << "}"
+            << ", \"gbs\": " << r.bandwidth() << ", \"stream_gbs\": " << stream
+            << ", \"stream_fraction\": " << (stream > 0 ? r.bandwidth() / stream : 0) << "}";
+    }
+    out << "\n  ]\n}\n";
+}
@@ -0,0 +1,120 @@
+#include "Communicator.hpp"
+#include "SharedWindow.hpp"
+#include "Utils.hpp"
+
+#include <stdexcept>
+
+struct CommunicatorCache {
+    std::unique_ptr<NodeTopology> topology;
+    // owns the duplicate returned by getPrivate()
+    std::unique_ptr<Communicator> privateComm;
+};
+
+Communicator::Communicator() : comm(MPI_COMM_WORLD) {
+    // all references to MPI_COMM_WORLD share one topology and one private duplicate
+    static std::shared_ptr<CommunicatorCache> world = std::make_shared<CommunicatorCache>();
+    cache = world;
+}
+
+Communicator::Communicator(MPI_Comm comm) : comm(comm), cache(std::make_shared<CommunicatorCache>()) {}
+
+Communicator Communicator::own(MPI_Comm comm) {
+    Communicator c(comm);
+    c.owner = std::shared_ptr<MPI_Comm>(new MPI_Comm(comm), [](MPI_Comm* p) {
+        // copies may outlive terminateSkeletons(), MPI_Comm_free is only allowed before MPI_Finalize
+        int finalized = 0;
+        MPI_Finalized(&finalized);
+        if (!finalized && *p != MPI_COMM_NULL)
+            MPI_Comm_free(p);
+        delete p;
+    });
+    return c;
+}
+
+Communicator Communicator::split(int color, int key) const {
+    MPI_Comm sub;
+    MPI_Comm_split(comm, color, key, &sub);
+    return own(sub);
+}
+
+Communicator Communicator::splitShared() const {
+    MPI_Comm sub;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, getRank(), MPI_INFO_NULL, &sub);
+    return own(sub);
+}
+
+Communicator Communicator::cartesian(int rows, int cols) const {
+    int dims[2] = {rows, cols};
+    int periods[2] = {0, 0};
+    MPI_Comm grid;
+    MPI_Cart_create(comm, 2, dims, periods, 0, &grid);
+    return own(grid);
+}
+
+Communicator Communicator::cartesianSub(bool keepRows, bool keepCols) const {
+    int remain[2] = {keepRows ? 1 : 0, keepCols ? 1 : 0};
+    MPI_Comm sub;
+    MPI_Cart_sub(comm, remain, &sub);
+    return own(sub);
+}
+
+int Communicator::getRank() const {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    return rank;
+}
+
+int Communicator::getSize() const {
+    int size;
+    MPI_Comm_size(comm, &size);
+    return size;
+}
+
+const NodeTopology& Communicator::getTopology() const {
+    if (cache->topology)
+        return *cache->topology;
+
+    const int rank = getRank();
+    std::unique_ptr<NodeTopology> t(new NodeTopology());
+    t->node = splitShared();
+    t->leaders = split(t->node.getRank() == 0 ? 0 : MPI_UNDEFINED, rank);
+
+    t->nodeRanks.resize(t->node.getSize());
+    MPI_Allgather(&rank, 1, MPI_INT, t->nodeRanks.data(), 1, MPI_INT, t->node.get());
+
+    int consecutive = 1;
+    for (std::size_t i = 1; i < t->nodeRanks.size(); i++) {
+        if (t->nodeRanks[i] != t->nodeRanks[i - 1] + 1)
+            consecutive = 0;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &consecutive, 1, MPI_INT, MPI_LAND, comm);
+    t->consecutive = consecutive != 0;
+
+    cache->topology = std::move(t);
+    return *cache->topology;
+}
+
+MPI_Comm Communicator::getPrivate() const {
+    if (!cache->privateComm) {
+        MPI_Comm dup;
+        MPI_Comm_dup(comm, &dup);
+        cache->privateComm.reset(new Communicator(own(dup)));
+    }
+    return cache->privateComm->get();
+}
+
+void requireAll(bool ok, const std::string& message, const Communicator& communicator) {
+    int local = ok ? 1 : 0;
+    int all;
+    MPI_Allreduce(&local, &all, 1, MPI_INT, MPI_MIN, communicator.get());
+    if (!all)
+        throw std::runtime_error(message);
+}
+
+SharedWindow& NodeTopology::getScratch(std::size_t bytes) const {
+    // whole cache lines, so that the slots of different processes do not share lines
+    bytes = (bytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    if (!scratch || scratch->getSegmentSize(node.getRank()) < bytes)
+        scratch = std::make_shared<SharedWindow>(bytes, node);
+    return *scratch;
+}
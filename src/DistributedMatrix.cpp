@@ -0,0 +1,566 @@
+#include "DistributedMatrix.hpp"
+
+template <typename T>
+DistributedMatrix<T>::DistributedMatrix() {}
+
+template <typename T>
+DistributedMatrix<T>::DistributedMatrix(GlobalIndex rows, GlobalIndex cols, const Communicator& communicator,
+                                        int gridRows, GlobalIndex tileSize)
+    : layout(rows, cols, communicator, gridRows, tileSize) {
+    init();
+}
+
+template <typename T>
+DistributedMatrix<T>::DistributedMatrix(const MatrixLayout& layout) : layout(layout) {
+    init();
+}
+
+template <typename T>
+template <typename Generator, typename>
+DistributedMatrix<T>::DistributedMatrix(const MatrixLayout& layout, Generator f) : layout(layout) {
+    localMatrix.resize(layout.getStorageSize());
+    T* local = localMatrix.data();
+    const GlobalIndex firstRow = layout.getFirstRow();
+    const GlobalIndex firstCol = layout.getFirstCol();
+
+    // generating the elements is the first touch of the block
+    forEachSegment([&] (GlobalIndex i, GlobalIndex j, GlobalIndex offset, GlobalIndex width) {
+        for (GlobalIndex k = 0; k < width; k++) {
+            local[offset + k] = f(firstRow + i, firstCol + j + k);
+        }
+    });
+}
+
+template <typename T>
+DistributedMatrix<T>::DistributedMatrix(const DistributedMatrix<T>& cs) : layout(cs.layout) {
+    *this = cs;
+}
+
+template <typename T>
+DistributedMatrix<T>& DistributedMatrix<T>::operator=(const DistributedMatrix<T>& cs) {
+    if (this == &cs)
+        return *this;
+
+    if (layout != cs.layout || localMatrix.size() != cs.localMatrix.size()) {
+        layout = cs.layout;
+        localMatrix.clear();
+        localMatrix.resize(layout.getStorageSize());
+    }
+
+    // copy in parallel, which is also the first touch of a new block
+    T* local = localMatrix.data();
+    const T* source = cs.localMatrix.data();
+    forEachSegment([&] (GlobalIndex, GlobalIndex, GlobalIndex offset, GlobalIndex width) {
+        for (GlobalIndex k = 0; k < width; k++) {
+            local[offset + k] = source[offset + k];
+        }
+    });
+    return *this;
+}
+
+template <typename T>
+void DistributedMatrix<T>::init() {
+    localMatrix.resize(layout.getStorageSize());
+    T* local = localMatrix.data();
+
+    forEachSegment([&] (GlobalIndex, GlobalIndex, GlobalIndex offset, GlobalIndex width) {
+        for (GlobalIndex k = 0; k < width; k++) {
+            local[offset + k] = T();
+        }
+    });
+}
+
+template <typename T>
+template <typename Body>
+void DistributedMatrix<T>::forEachSegment(Body body) const {
+    const GlobalIndex localRows = layout.getLocalRows();
+    const GlobalIndex localCols = layout.getLocalCols();
+    const GlobalIndex tileSize = layout.getTileSize();
+    ThreadTimer timer;
+
+    #pragma omp parallel
+    {
+        timer.start();
+        #pragma omp for schedule(static) nowait
+        for (GlobalIndex i = 0; i < localRows; i++) {
+            for (GlobalIndex j = 0; j < localCols; j += tileSize) {
+                body(i, j, layout.offsetOf(i, j), std::min(tileSize, localCols - j));
+            }
+        }
+        timer.stop();
+    }
+}
+
+template <typename T>
+void DistributedMatrix<T>::gatherMatrix(std::vector<T>& results) const {
+    const GlobalIndex rows = layout.getRows();
+    const GlobalIndex cols = layout.getCols();
+    if (rows * cols > INT_MAX)
+        throw std::runtime_error("gatherMatrix: matrix of more than INT_MAX elements");
+
+    ProfileScope scope("gatherMatrix", PROFILE_CALL);
+    const GlobalIndex localCols = layout.getLocalCols();
+    const Communicator& communicator = layout.getCommunicator();
+    const int numProcesses = communicator.getSize();
+    const bool root = communicator.getRank() == 0;
+
+    // the local block in row-major order
+    std::vector<T> block(layout.getLocalRows() * localCols);
+    const T* local = localMatrix.data();
+    forEachSegment([&] (GlobalIndex i, GlobalIndex j, GlobalIndex offset, GlobalIndex width) {
+        for (GlobalIndex k = 0; k < width; k++) {
+            block[i * localCols + j + k] = local[offset + k];
+        }
+    });
+
+    const Distribution& rowDistribution = layout.getRowDistribution();
+    const Distribution& colDistribution = layout.getColDistribution();
+    std::vector<int> counts(numProcesses), displacements(numProcesses);
+    for (int p = 0, displacement = 0; p < numProcesses; p++) {
+        counts[p] = (int)(rowDistribution.localSizeOf(p / layout.getGridCols())
+                          * colDistribution.localSizeOf(p % layout.getGridCols()));
+        displacements[p] = displacement;
+        displacement += counts[p];
+    }
+
+    std::vector<T> blocks(root ? rows * cols : 0);
+    {
+        ProfileScope communication("gatherMatrix", PROFILE_COMMUNICATION);
+        communication.addBytes(block.size() * sizeof(T), blocks.size() * sizeof(T));
+        MPI_Gatherv(block.data(), (int)block.size(), MpiDatatype<T>::get(), blocks.data(), counts.data(),
+                    displacements.data(), MpiDatatype<T>::get(), 0, communicator.get());
+    }
+
+    if (!root)
+        return;
+
+    // place the block of every process at its rows and columns
+    results.resize(rows * cols);
+    for (int p = 0; p < numProcesses; p++) {
+        const int r = p / layout.getGridCols();
+        const int c = p % layout.getGridCols();
+        const GlobalIndex blockRows = rowDistribution.localSizeOf(r);
+        const GlobalIndex blockCols = colDistribution.localSizeOf(c);
+        const GlobalIndex firstRow = rowDistribution.firstIndexOf(r);
+        const GlobalIndex firstCol = colDistribution.firstIndexOf(c);
+        for (GlobalIndex i = 0; i < blockRows; i++) {
+            std::copy(blocks.begin() + displacements[p] + i * blockCols,
+                      blocks.begin() + displacements[p] + (i + 1) * blockCols,
+                      results.begin() + (firstRow + i) * cols + firstCol);
+        }
+    }
+}
+
+template <typename T>
+void DistributedMatrix<T>::show(const std::string& descr) const {
+    std::vector<T> elements;
+    gatherMatrix(elements);
+
+    if (layout.getCommunicator().getRank() != 0)
+        return;
+
+    std::ostream& s = std::cout;
+    if (descr.size() > 0)
+        s << descr << std::endl;
+    for (GlobalIndex i = 0; i < layout.getRows(); i++) {
+        s << "[ ";
+        for (GlobalIndex j = 0; j < layout.getCols(); j++) {
+            s << elements[i * layout.getCols() + j] << " ";
+        }
+        s << "]" << std::endl;
+    }
+    s << std::endl;
+}
+
+template <typename T>
+template <typename R, typename MapFunctor>
+DistributedMatrix<R> DistributedMatrix<T>::map(MapFunctor& f) const {
+    DistributedMatrix<R> out(layout);
+    map(f, out);
+    return out;
+}
+
+template <typename T>
+template <typename R, typename MapFunctor>
+void DistributedMatrix<T>::map(MapFunctor& f, DistributedMatrix<R>& out) const {
+    static_assert(IsMapFunctor<MapFunctor, T, R>::value, "map: functor has to be callable as R f(T) const");
+
+    if (out.layout != layout)
+        out = DistributedMatrix<R>(layout);
+
+    ProfileScope scope("map", PROFILE_CALL);
+    R* target = out.localMatrix.data();
+    const T* local = localMatrix.data();
+    forEachSegment([&] (GlobalIndex, GlobalIndex, GlobalIndex offset, GlobalIndex width) {
+        for (GlobalIndex k = 0; k < width; k++) {
+            target[offset + k] = f(local[offset + k]);
+        }
+    });
+}
+
+template <typename T>
+template <typename MapFunctor>
+void DistributedMatrix<T>::mapInPlace(MapFunctor& f) {
+    static_assert(IsMapFunctor<MapFunctor, T, T>::value, "mapInPlace: functor has to be callable as T f(T) const");
+
+    ProfileScope scope("mapInPlace", PROFILE_CALL);
+    T* local = localMatrix.data();
+    forEachSegment([&] (GlobalIndex, GlobalIndex, GlobalIndex offset, GlobalIndex width) {
+        for (GlobalIndex k = 0; k < width; k++) {
+            local[offset + k] = f(local[offset + k]);
+        }
+    });
+}
+
+template <typename T>
+template <typename R, typename T2, typename ZipFunctor>
+DistributedMatrix<R> DistributedMatrix<T>::zip(const DistributedMatrix<T2>& b, ZipFunctor& f) const {
+    DistributedMatrix<R> out(layout);
+    zip(b, f, out);
+    return out;
+}
+
+template <typename T>
+template <typename R, typename T2, typename ZipFunctor>
+void DistributedMatrix<T>::zip(const DistributedMatrix<T2>& b, ZipFunctor& f, DistributedMatrix<R>& out) const {
+    static_assert(IsZipFunctor<ZipFunctor, T, T2, R>::value, "zip: functor has to be callable as R f(T, T2) const");
+
+    if (b.layout != layout)
+        throw std::invalid_argument("zip: matrices have different layouts");
+    if (out.layout != layout)
+        out = DistributedMatrix<R>(layout);
+
+    ProfileScope scope("zip", PROFILE_CALL);
+    R* target = out.localMatrix.data();
+    const T* local = localMatrix.data();
+    const T2* other = b.localMatrix.data();
+    forEachSegment([&] (GlobalIndex, GlobalIndex, GlobalIndex offset, GlobalIndex width) {
+        for (GlobalIndex k = 0; k < width; k++) {
+            target[offset + k] = f(local[offset + k], other[offset + k]);
+        }
+    });
+}
+
+template <typename T>
+template <typename T2, typename ZipFunctor>
+void DistributedMatrix<T>::zipInPlace(const DistributedMatrix<T2>& b, ZipFunctor& f) {
+    static_assert(IsZipFunctor<ZipFunctor, T, T2, T>::value, "zipInPlace: functor has to be callable as T f(T, T2) const");
+
+    if (b.layout != layout)
+        throw std::invalid_argument("zipInPlace: matrices have different layouts");
+
+    ProfileScope scope("zipInPlace", PROFILE_CALL);
+    T* local = localMatrix.data();
+    const T2* other = b.localMatrix.data();
+    forEachSegment([&] (GlobalIndex, GlobalIndex, GlobalIndex offset, GlobalIndex width) {
+        for (GlobalIndex k = 0; k < width; k++) {
+            local[offset + k] = f(local[offset + k], other[offset + k]);
+        }
+    });
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+OptionalValue<T> DistributedMatrix<T>::reduceBlock(ReduceFunctor& f, const T* identity) const {
+    static_assert(IsReduceFunctor<ReduceFunctor, T>::value, "reduce: functor has to be callable as T f(T, T) const");
+
+    const GlobalIndex localRows = layout.getLocalRows();
+    const GlobalIndex localCols = layout.getLocalCols();
+    const GlobalIndex tileSize = layout.getTileSize();
+    const T* local = localMatrix.data();
+    std::vector<PaddedValue<OptionalValue<T>>> partials(omp_get_max_threads());
+    SkipEmpty<ReduceFunctor> skip{f};
+    ThreadTimer timer;
+
+    #pragma omp parallel
+    {
+        const int thread = omp_get_thread_num();
+        const int numThreads = omp_get_num_threads();
+        timer.start();
+
+        // Each thread folds the rows it also works on in the other skeletons, in row-major order;
+        // without a neutral element the fold starts from the first element of the rows
+        GlobalIndex begin, end;
+        staticRange(localRows, thread, numThreads, begin, end);
+        T partial = identity != nullptr ? *identity : T();
+        bool valid = identity != nullptr;
+        for (GlobalIndex i = begin; i < end; i++) {
+            for (GlobalIndex j = 0; j < localCols; j += tileSize) {
+                const T* segment = local + layout.offsetOf(i, j);
+                const GlobalIndex width = std::min(tileSize, localCols - j);
+                GlobalIndex k = 0;
+                if (!valid) {
+                    partial = segment[k++];
+                    valid = true;
+                }
+                for (; k < width; k++) {
+                    partial = f(partial, segment[k]);
+                }
+            }
+        }
+        partials[thread].value = {partial, valid};
+        timer.stop();
+
+        // Merge neighbouring partials in a tree, the left operand always belongs to the lower thread
+        for (int stride = 1; stride < numThreads; stride *= 2) {
+            #pragma omp barrier
+            if (thread % (2 * stride) == 0 && thread + stride < numThreads) {
+                partials[thread].value = skip(partials[thread].value, partials[thread + stride].value);
+            }
+        }
+    }
+
+    return partials[0].value;
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+T DistributedMatrix<T>::reduceMatrix(ReduceFunctor& f, const T* identity, bool all) const {
+    typedef ReduceIdentity<ReduceFunctor, T> Identity;
+    const T known = Identity::get();
+    if (identity == nullptr && Identity::known)
+        identity = &known;
+
+    const char* name = all ? "allReduce" : "reduce";
+    ProfileScope scope(name, PROFILE_CALL);
+    const OptionalValue<T> local = reduceBlock(f, identity);
+
+    ProfileScope communication(name, PROFILE_COMMUNICATION);
+    if (identity != nullptr) {
+        communication.addBytes(sizeof(T), sizeof(T));
+        return combineProcessResults(local.value, f, all, layout.getCommunicator());
+    }
+
+    // processes with empty blocks contribute nothing
+    communication.addBytes(sizeof(OptionalValue<T>), sizeof(OptionalValue<T>));
+    SkipEmpty<ReduceFunctor> skip{f};
+    return combineProcessResults(local, skip, all, layout.getCommunicator()).value;
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+T DistributedMatrix<T>::reduce(ReduceFunctor& f) const {
+    return reduceMatrix(f, nullptr, false);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+T DistributedMatrix<T>::reduce(ReduceFunctor& f, const T& identity) const {
+    return reduceMatrix(f, &identity, false);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+T DistributedMatrix<T>::allReduce(ReduceFunctor& f) const {
+    return reduceMatrix(f, nullptr, true);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+T DistributedMatrix<T>::allReduce(ReduceFunctor& f, const T& identity) const {
+    return reduceMatrix(f, &identity, true);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+void DistributedMatrix<T>::combinePartials(const std::vector<T>& partials, bool valid, std::vector<T>& results,
+                                           ReduceFunctor& f, const Communicator& communicator) const {
+    // an empty block has no partials to contribute, its processes send empty OptionalValues
+    std::vector<OptionalValue<T>> optionals(partials.size());
+    for (size_t i = 0; i < partials.size(); i++) {
+        optionals[i] = {partials[i], valid};
+    }
+    std::vector<OptionalValue<T>> combined(results.size());
+    SkipEmpty<ReduceFunctor> skip{f};
+    combineProcessArrays(optionals.data(), combined.data(), optionals.size(), skip, 0, communicator.get());
+    for (size_t i = 0; i < combined.size(); i++) {
+        results[i] = combined[i].value;
+    }
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+VectorDistribution<T> DistributedMatrix<T>::reduceRows(ReduceFunctor& f) const {
+    return foldRows(f, nullptr);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+VectorDistribution<T> DistributedMatrix<T>::reduceRows(ReduceFunctor& f, const T& identity) const {
+    return foldRows(f, &identity);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+VectorDistribution<T> DistributedMatrix<T>::foldRows(ReduceFunctor& f, const T* identity) const {
+    static_assert(IsReduceFunctor<ReduceFunctor, T>::value, "reduceRows: functor has to be callable as T f(T, T) const");
+    typedef ReduceIdentity<ReduceFunctor, T> Identity;
+    const T known = Identity::get();
+    if (identity == nullptr && Identity::known)
+        identity = &known;
+
+    ProfileScope scope("reduceRows", PROFILE_CALL);
+    const GlobalIndex localRows = layout.getLocalRows();
+    const T* local = localMatrix.data();
+
+    // every row is folded by one thread, segment by segment; without a neutral element from the first
+    // segment on
+    std::vector<T> partials(localRows, identity != nullptr ? *identity : T());
+    forEachSegment([&] (GlobalIndex i, GlobalIndex j, GlobalIndex offset, GlobalIndex width) {
+        GlobalIndex k = 0;
+        T partial = partials[i];
+        if (identity == nullptr && j == 0)
+            partial = local[offset + k++];
+        for (; k < width; k++) {
+            partial = f(partial, local[offset + k]);
+        }
+        partials[i] = partial;
+    });
+
+    // the first process of every grid row combines the partial rows in grid column order
+    const bool root = layout.getGridCol() == 0;
+    const bool valid = identity != nullptr || layout.getLocalCols() > 0;
+    std::vector<T> rowResults(root ? localRows : 0);
+    VectorDistribution<T> out(layout.getRows(), layout.getCommunicator());
+    {
+        ProfileScope communication("reduceRows", PROFILE_COMMUNICATION);
+        communication.addBytes(localRows * sizeof(T), rowResults.size() * sizeof(T));
+        if (identity != nullptr)
+            combineProcessArrays(partials.data(), rowResults.data(), localRows, f, 0, layout.getRowCommunicator().get());
+        else
+            combinePartials(partials, valid, rowResults, f, layout.getRowCommunicator());
+        toVector(rowResults.data(), layout.getFirstRow(), rowResults.size(), out);
+    }
+    return out;
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+VectorDistribution<T> DistributedMatrix<T>::reduceCols(ReduceFunctor& f) const {
+    return foldCols(f, nullptr);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+VectorDistribution<T> DistributedMatrix<T>::reduceCols(ReduceFunctor& f, const T& identity) const {
+    return foldCols(f, &identity);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+VectorDistribution<T> DistributedMatrix<T>::foldCols(ReduceFunctor& f, const T* identity) const {
+    static_assert(IsReduceFunctor<ReduceFunctor, T>::value, "reduceCols: functor has to be callable as T f(T, T) const");
+    typedef ReduceIdentity<ReduceFunctor, T> Identity;
+    const T known = Identity::get();
+    if (identity == nullptr && Identity::known)
+        identity = &known;
+
+    ProfileScope scope("reduceCols", PROFILE_CALL);
+    const GlobalIndex localRows = layout.getLocalRows();
+    const GlobalIndex localCols = layout.getLocalCols();
+    const GlobalIndex tileSize = layout.getTileSize();
+    const T* local = localMatrix.data();
+    std::vector<T> partials(localCols, identity != nullptr ? *identity : T());
+    // without a neutral element the columns start from the first local row
+    const GlobalIndex firstRow = identity == nullptr && localRows > 0 ? 1 : 0;
+    ThreadTimer timer;
+
+    // every thread folds whole tile columns top to bottom, the partials of a tile stay in cache
+    #pragma omp parallel
+    {
+        timer.start();
+        #pragma omp for schedule(static) nowait
+        for (GlobalIndex tileCol = 0; tileCol < layout.getTileCols(); tileCol++) {
+            const GlobalIndex j = tileCol * tileSize;
+            const GlobalIndex width = std::min(tileSize, localCols - j);
+            T* partial = partials.data() + j;
+            if (firstRow > 0)
+                std::copy(local + layout.offsetOf(0, j), local + layout.offsetOf(0, j) + width, partial);
+            for (GlobalIndex i = firstRow; i < localRows; i++) {
+                const T* segment = local + layout.offsetOf(i, j);
+                for (GlobalIndex k = 0; k < width; k++) {
+                    partial[k] = f(partial[k], segment[k]);
+                }
+            }
+        }
+        timer.stop();
+    }
+
+    // the first process of every grid column combines the partial columns in grid row order
+    const bool root = layout.getGridRow() == 0;
+    const bool valid = identity != nullptr || localRows > 0;
+    std::vector<T> colResults(root ? localCols : 0);
+    VectorDistribution<T> out(layout.getCols(), layout.getCommunicator());
+    {
+        ProfileScope communication("reduceCols", PROFILE_COMMUNICATION);
+        communication.addBytes(localCols * sizeof(T), colResults.size() * sizeof(T));
+        if (identity != nullptr)
+            combineProcessArrays(partials.data(), colResults.data(), localCols, f, 0, layout.getColCommunicator().get());
+        else
+            combinePartials(partials, valid, colResults, f, layout.getColCommunicator());
+        toVector(colResults.data(), layout.getFirstCol(), colResults.size(), out);
+    }
+    return out;
+}
+
+template <typename T>
+VectorDistribution<T> DistributedMatrix<T>::multiply(const VectorDistribution<T>& x) const {
+    VectorDistribution<T> y;
+    multiply(x, y);
+    return y;
+}
+
+template <typename T>
+void DistributedMatrix<T>::multiply(const VectorDistribution<T>& x, VectorDistribution<T>& y) const {
+    const Communicator& communicator = layout.getCommunicator();
+    if (x.getSize() != layout.getCols())
+        throw std::invalid_argument("multiply: vector needs one element per matrix column");
+    if (x.getCommunicator() != communicator)
+        throw std::invalid_argument("multiply: vector lives on a different communicator");
+    if (!x.getDistribution().isContiguous())
+        throw std::invalid_argument("multiply: vector needs a contiguous distribution");
+
+    ProfileScope scope("multiply", PROFILE_CALL);
+    const GlobalIndex localRows = layout.getLocalRows();
+    const GlobalIndex localCols = layout.getLocalCols();
+    const T* local = localMatrix.data();
+
+    // the elements of x matching the local columns
+    std::vector<T> xs(localCols);
+    {
+        ProfileScope communication("multiply", PROFILE_COMMUNICATION);
+        communication.addBytes(0, localCols * sizeof(T));
+        redistributeRange(x.getLocalData(), x.getFirstIndex(), x.getLocalSize(), xs.data(), layout.getFirstCol(),
+                          localCols, communicator.get());
+    }
+
+    std::vector<T> partials(localRows, T());
+    forEachSegment([&] (GlobalIndex i, GlobalIndex j, GlobalIndex offset, GlobalIndex width) {
+        const T* segment = local + offset;
+        const T* xSegment = xs.data() + j;
+        T sum = T();
+        for (GlobalIndex k = 0; k < width; k++) {
+            sum += segment[k] * xSegment[k];
+        }
+        partials[i] += sum;
+    });
+
+    const Distribution balanced = Distribution::balancedBlock(layout.getRows(), communicator.getSize());
+    if (y.getCommunicator() != communicator || y.getDistribution() != balanced)
+        y = VectorDistribution<T>(balanced, communicator);
+
+    const bool root = layout.getGridCol() == 0;
+    std::vector<T> rowResults(root ? localRows : 0);
+    std::plus<T> plus;
+    ProfileScope communication("multiply", PROFILE_COMMUNICATION);
+    communication.addBytes(localRows * sizeof(T), rowResults.size() * sizeof(T));
+    combineProcessArrays(partials.data(), rowResults.data(), localRows, plus, 0, layout.getRowCommunicator().get());
+    toVector(rowResults.data(), layout.getFirstRow(), rowResults.size(), y);
+}
+
+template <typename T>
+void DistributedMatrix<T>::toVector(const T* data, GlobalIndex first, GlobalIndex count,
+                                    VectorDistribution<T>& out) const {
+    redistributeRange(data, first, count, out.getLocalData(), out.getFirstIndex(), out.getLocalSize(),
+                      layout.getCommunicator().get());
+}
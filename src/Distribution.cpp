@@ -0,0 +1,134 @@
+#include "Distribution.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+Distribution::Distribution() : kind(BLOCK), size(0), numProcesses(0), blockSize(0), offsets(1, 0) {}
+
+Distribution::Distribution(Kind kind, GlobalIndex size, int numProcesses, GlobalIndex blockSize)
+    : kind(kind), size(size), numProcesses(numProcesses), blockSize(blockSize), offsets(numProcesses + 1, 0) {
+    if (numProcesses <= 0)
+        throw std::invalid_argument("Distribution: number of processes has to be positive");
+    if (size < 0)
+        throw std::invalid_argument("Distribution: size must not be negative");
+}
+
+Distribution Distribution::balancedBlock(GlobalIndex size, int numProcesses) {
+    Distribution d(BLOCK, size, numProcesses, 0);
+    const GlobalIndex localSize = size / numProcesses;
+    const GlobalIndex remainingSize = size % numProcesses;
+
+    // the first remainingSize processes get one additional element
+    for (int p = 0; p < numProcesses; p++) {
+        d.offsets[p + 1] = d.offsets[p] + localSize + (p < remainingSize ? 1 : 0);
+    }
+    return d;
+}
+
+Distribution Distribution::blockCyclic(GlobalIndex size, int numProcesses, GlobalIndex blockSize) {
+    if (blockSize <= 0)
+        throw std::invalid_argument("Distribution: block size has to be positive");
+
+    Distribution d(BLOCK_CYCLIC, size, numProcesses, blockSize);
+    const GlobalIndex numBlocks = (size + blockSize - 1) / blockSize;
+
+    for (int p = 0; p < numProcesses; p++) {
+        GlobalIndex blocks = numBlocks / numProcesses + (p < numBlocks % numProcesses ? 1 : 0);
+        GlobalIndex localSize = blocks * blockSize;
+        // the last block may be incomplete
+        if (numBlocks > 0 && (numBlocks - 1) % numProcesses == p)
+            localSize -= numBlocks * blockSize - size;
+        d.offsets[p + 1] = d.offsets[p] + localSize;
+    }
+    return d;
+}
+
+Distribution Distribution::weightedBlock(GlobalIndex size, const std::vector<double>& weights) {
+    Distribution d(BLOCK, size, (int)weights.size(), 0);
+    double totalWeight = 0;
+
+    for (double w : weights) {
+        if (w < 0)
+            throw std::invalid_argument("Distribution: weights must not be negative");
+        totalWeight += w;
+    }
+    if (totalWeight <= 0)
+        throw std::invalid_argument("Distribution: at least one weight has to be positive");
+
+    // round the cumulative share, so that the sizes add up to size exactly
+    double cumulativeWeight = 0;
+    for (int p = 0; p < d.numProcesses; p++) {
+        cumulativeWeight += weights[p];
+        d.offsets[p + 1] = (GlobalIndex)std::llround((double)size * (cumulativeWeight / totalWeight));
+    }
+    d.offsets[d.numProcesses] = size;
+    return d;
+}
+
+Distribution Distribution::irregularBlock(const std::vector<GlobalIndex>& localSizes) {
+    GlobalIndex size = 0;
+    for (GlobalIndex localSize : localSizes) {
+        if (localSize < 0)
+            throw std::invalid_argument("Distribution: block sizes must not be negative");
+        size += localSize;
+    }
+
+    Distribution d(BLOCK, size, (int)localSizes.size(), 0);
+    for (int p = 0; p < d.numProcesses; p++) {
+        d.offsets[p + 1] = d.offsets[p] + localSizes[p];
+    }
+    return d;
+}
+
+GlobalIndex Distribution::globalIndex(int process, GlobalIndex localIndex) const {
+    if (kind == BLOCK)
+        return offsets[process] + localIndex;
+
+    const GlobalIndex localBlock = localIndex / blockSize;
+    return (localBlock * numProcesses + process) * blockSize + localIndex % blockSize;
+}
+
+int Distribution::ownerOf(GlobalIndex globalIndex) const {
+    if (kind == BLOCK_CYCLIC)
+        return (int)((globalIndex / blockSize) % numProcesses);
+
+    // binary search for the last offset <= globalIndex, skipping empty blocks
+    int low = 0, high = numProcesses - 1;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (offsets[mid] <= globalIndex)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return low;
+}
+
+GlobalIndex Distribution::localIndexOf(GlobalIndex globalIndex) const {
+    if (kind == BLOCK)
+        return globalIndex - offsets[ownerOf(globalIndex)];
+
+    const GlobalIndex block = globalIndex / blockSize;
+    return (block / numProcesses) * blockSize + globalIndex % blockSize;
+}
+
+GlobalIndex Distribution::runLength(GlobalIndex globalIndex) const {
+    if (kind == BLOCK)
+        return offsets[ownerOf(globalIndex) + 1] - globalIndex;
+
+    const GlobalIndex rest = blockSize - globalIndex % blockSize;
+    return rest < size - globalIndex ? rest : size - globalIndex;
+}
+
+bool Distribution::isUniform() const {
+    for (int p = 1; p < numProcesses; p++) {
+        if (localSizeOf(p) != localSizeOf(0))
+            return false;
+    }
+    return true;
+}
+
+bool Distribution::operator==(const Distribution& other) const {
+    return kind == other.kind && size == other.size && numProcesses == other.numProcesses
+           && blockSize == other.blockSize && offsets == other.offsets;
+}
@@ -0,0 +1,370 @@
+#include "Expressions.hpp"
+
+template <typename T>
+DistributionTerminal<T>::DistributionTerminal(const VectorDistribution<T>& vd)
+    : data(vd.getLocalData()), localSize(vd.getLocalSize()), distribution(&vd.getDistribution()),
+      communicator(&vd.getCommunicator()) {}
+
+template <typename R, typename E1, typename E2, typename ZipFunctor>
+ZipExpression<R, E1, E2, ZipFunctor>::ZipExpression(const E1& a, const E2& b, const ZipFunctor& f)
+    : a(a), b(b), f(f) {
+    // elements are combined by local index, so both operands have to share the layout
+    if (a.getDistribution() != b.getDistribution())
+        throw std::invalid_argument("zip: operands have different distributions");
+    if (a.getCommunicator() != b.getCommunicator())
+        throw std::invalid_argument("zip: operands live on different communicators");
+}
+
+template <typename R, typename E1, typename E2, typename ZipFunctor>
+ZipIndexExpression<R, E1, E2, ZipFunctor>::ZipIndexExpression(const E1& a, const E2& b, const ZipFunctor& f)
+    : a(a), b(b), f(f), indices(a.getDistribution(), a.getCommunicator()) {
+    if (a.getDistribution() != b.getDistribution())
+        throw std::invalid_argument("zipIndex: operands have different distributions");
+    if (a.getCommunicator() != b.getCommunicator())
+        throw std::invalid_argument("zipIndex: operands live on different communicators");
+}
+
+template <typename Derived, typename R>
+template <typename R2, typename MapFunctor>
+MapIndexExpression<R2, Derived, MapFunctor> SkeletonExpression<Derived, R>::mapIndex(MapFunctor &f) const {
+    return MapIndexExpression<R2, Derived, MapFunctor>(derived(), f);
+}
+
+template <typename Derived, typename R>
+template <typename R2, typename Other, typename ZipFunctor>
+ZipIndexExpression<R2, Derived, typename ExpressionOf<Other>::type, ZipFunctor>
+SkeletonExpression<Derived, R>::zipIndex(const Other& b, ZipFunctor& f) const {
+    return ZipIndexExpression<R2, Derived, typename ExpressionOf<Other>::type, ZipFunctor>(
+            derived(), ExpressionOf<Other>::get(b), f);
+}
+
+template <typename R, typename Generator>
+MapExpression<R, IndexExpression, Generator> generate(const Distribution& distribution, Generator& f,
+                                                     const Communicator& communicator) {
+    return MapExpression<R, IndexExpression, Generator>(IndexExpression(distribution, communicator), f);
+}
+
+template <typename Derived, typename R>
+template <typename R2, typename MapFunctor>
+MapExpression<R2, Derived, MapFunctor> SkeletonExpression<Derived, R>::map(MapFunctor &f) const {
+    return MapExpression<R2, Derived, MapFunctor>(derived(), f);
+}
+
+template <typename Derived, typename R>
+template <typename R2, typename Other, typename ZipFunctor>
+ZipExpression<R2, Derived, typename ExpressionOf<Other>::type, ZipFunctor>
+SkeletonExpression<Derived, R>::zip(const Other& b, ZipFunctor& f) const {
+    return ZipExpression<R2, Derived, typename ExpressionOf<Other>::type, ZipFunctor>(
+            derived(), ExpressionOf<Other>::get(b), f);
+}
+
+template <typename Derived, typename R>
+template <typename ReduceFunctor>
+R SkeletonExpression<Derived, R>::reduce(ReduceFunctor &f) const {
+    return reduceExpression<R>(derived(), f, false);
+}
+
+template <typename Derived, typename R>
+template <typename ReduceFunctor>
+R SkeletonExpression<Derived, R>::reduce(ReduceFunctor &f, const R& identity) const {
+    return reduceExpression(derived(), f, identity, false);
+}
+
+template <typename Derived, typename R>
+template <typename ReduceFunctor>
+R SkeletonExpression<Derived, R>::allReduce(ReduceFunctor &f) const {
+    return reduceExpression<R>(derived(), f, true);
+}
+
+template <typename Derived, typename R>
+template <typename ReduceFunctor>
+R SkeletonExpression<Derived, R>::allReduce(ReduceFunctor &f, const R& identity) const {
+    return reduceExpression(derived(), f, identity, true);
+}
+
+template <typename Derived, typename R>
+template <typename ReduceFunctor>
+SkeletonFuture<R> SkeletonExpression<Derived, R>::reduceAsync(ReduceFunctor &f) const {
+    return reduceExpressionAsync<R>(derived(), f);
+}
+
+template <typename Derived, typename R>
+template <typename ReduceFunctor>
+SkeletonFuture<R> SkeletonExpression<Derived, R>::reduceAsync(ReduceFunctor &f, const R& identity) const {
+    return reduceExpressionAsync(derived(), f, identity);
+}
+
+template <typename Derived, typename R>
+template <typename ReduceFunctor>
+R SkeletonExpression<Derived, R>::reduce(ReducePlan<R, ReduceFunctor>& plan) const {
+    return reduceExpression(derived(), plan);
+}
+
+template <typename Derived, typename R>
+void SkeletonExpression<Derived, R>::gatherVectors(std::vector<R>& results) const {
+    VectorDistribution<R> evaluated(*this);
+    evaluated.gatherVectors(results);
+}
+
+template <typename Derived, typename R>
+void SkeletonExpression<Derived, R>::show(const std::string& descr) const {
+    VectorDistribution<R> evaluated(*this);
+    evaluated.show(descr);
+}
+
+template <typename R, typename E>
+void evaluateExpression(const E& e, R* out) {
+    ProfileScope scope("evaluate", PROFILE_CALL);
+    ThreadTimer timer;
+    const GlobalIndex n = e.getLocalSize();
+
+    #pragma omp parallel
+    {
+        timer.start();
+        #pragma omp for schedule(static) nowait
+        for (GlobalIndex i = 0; i < n; i++) {
+            out[i] = e(i);
+        }
+        timer.stop();
+    }
+}
+
+template <typename R, typename E, typename ReduceFunctor>
+R foldRange(const E& e, ReduceFunctor& f, R acc, GlobalIndex begin, GlobalIndex end) {
+    typedef SimdReduction<R, typename std::remove_const<ReduceFunctor>::type> Simd;
+    const int lanes = 8;
+
+    if constexpr (Simd::sum) {
+        #pragma omp simd reduction(+:acc)
+        for (GlobalIndex i = begin; i < end; i++) {
+            acc += e(i);
+        }
+    } else if constexpr (Simd::product) {
+        #pragma omp simd reduction(*:acc)
+        for (GlobalIndex i = begin; i < end; i++) {
+            acc *= e(i);
+        }
+    } else if constexpr (FunctorTraits<ReduceFunctor>::commutative && std::is_arithmetic<R>::value) {
+        // the functor may be applied in any order, so fold interleaved elements into separate lanes;
+        // the lanes start from their first elements, acc need not be neutral
+        GlobalIndex i = begin;
+        if (end - begin >= lanes) {
+            R lane[lanes];
+            for (int l = 0; l < lanes; l++) {
+                lane[l] = e(i + l);
+            }
+            for (i += lanes; i + lanes <= end; i += lanes) {
+                #pragma omp simd
+                for (int l = 0; l < lanes; l++) {
+                    lane[l] = f(lane[l], e(i + l));
+                }
+            }
+            for (int l = 0; l < lanes; l++) {
+                acc = f(acc, lane[l]);
+            }
+        }
+        for (; i < end; i++) {
+            acc = f(acc, e(i));
+        }
+    } else {
+        for (GlobalIndex i = begin; i < end; i++) {
+            acc = f(acc, e(i));
+        }
+    }
+    return acc;
+}
+
+template <typename R, typename E, typename ReduceFunctor>
+R reduceLocal(const E& e, ReduceFunctor& f, const R& identity) {
+    std::vector<PaddedValue<R>> partials(omp_get_max_threads());
+    return reduceLocal(e, f, identity, partials);
+}
+
+template <typename R, typename E, typename ReduceFunctor>
+R reduceLocal(const E& e, ReduceFunctor& f, const R& identity, std::vector<PaddedValue<R>>& partials) {
+    static_assert(IsReduceFunctor<ReduceFunctor, R>::value, "reduce: functor has to be callable as T f(T, T) const");
+
+    const GlobalIndex n = e.getLocalSize();
+    ThreadTimer timer;
+
+    // multiple threads enter parallel region
+    #pragma omp parallel
+    {
+        const int thread = omp_get_thread_num();
+        const int numThreads = omp_get_num_threads();
+        timer.start();
+
+        // Each thread folds a contiguous chunk, the expression is evaluated on the fly
+        GlobalIndex begin, end;
+        staticRange(n, thread, numThreads, begin, end);
+        partials[thread].value = foldRange(e, f, identity, begin, end);
+        timer.stop();
+
+        // Merge neighbouring partials in a tree, the left operand always belongs to the lower thread
+        for (int stride = 1; stride < numThreads; stride *= 2) {
+            #pragma omp barrier
+            if (thread % (2 * stride) == 0 && thread + stride < numThreads) {
+                partials[thread].value = f(partials[thread].value, partials[thread + stride].value);
+            }
+        }
+    }
+
+    return partials[0].value;
+}
+
+template <typename R, typename E, typename ReduceFunctor>
+OptionalValue<R> reduceLocalSeeded(const E& e, ReduceFunctor& f) {
+    static_assert(IsReduceFunctor<ReduceFunctor, R>::value, "reduce: functor has to be callable as T f(T, T) const");
+
+    const GlobalIndex n = e.getLocalSize();
+    std::vector<PaddedValue<OptionalValue<R>>> partials(omp_get_max_threads());
+    SkipEmpty<ReduceFunctor> skip{f};
+    ThreadTimer timer;
+
+    #pragma omp parallel
+    {
+        const int thread = omp_get_thread_num();
+        const int numThreads = omp_get_num_threads();
+        timer.start();
+
+        // Each thread folds its chunk onto the first element of the chunk
+        GlobalIndex begin, end;
+        staticRange(n, thread, numThreads, begin, end);
+        partials[thread].value.valid = begin < end;
+        if (begin < end)
+            partials[thread].value.value = foldRange(e, f, R(e(begin)), begin + 1, end);
+        timer.stop();
+
+        // Merge neighbouring partials in a tree, skipping empty chunks
+        for (int stride = 1; stride < numThreads; stride *= 2) {
+            #pragma omp barrier
+            if (thread % (2 * stride) == 0 && thread + stride < numThreads) {
+                partials[thread].value = skip(partials[thread].value, partials[thread + stride].value);
+            }
+        }
+    }
+
+    return partials[0].value;
+}
+
+template <typename R, typename E, typename ReduceFunctor>
+R reduceExpression(const E& e, ReduceFunctor& f, const R& identity, bool all) {
+    ProfileScope scope(all ? "allReduce" : "reduce", PROFILE_CALL);
+    const R local = reduceLocal(e, f, identity);
+
+    // Combine the partial results of all processes in a reduction tree
+    ProfileScope communication(all ? "allReduce" : "reduce", PROFILE_COMMUNICATION);
+    communication.addBytes(sizeof(R), sizeof(R));
+    return combineProcessResults(local, f, all, e.getCommunicator());
+}
+
+template <typename R, typename E, typename ReduceFunctor>
+R reduceExpression(const E& e, ReduceFunctor& f, bool all) {
+    typedef ReduceIdentity<ReduceFunctor, R> Identity;
+    if constexpr (Identity::known) {
+        return reduceExpression(e, f, Identity::get(), all);
+    } else {
+        ProfileScope scope(all ? "allReduce" : "reduce", PROFILE_CALL);
+        const OptionalValue<R> local = reduceLocalSeeded<R>(e, f);
+
+        // processes with empty blocks contribute nothing
+        ProfileScope communication(all ? "allReduce" : "reduce", PROFILE_COMMUNICATION);
+        communication.addBytes(sizeof(OptionalValue<R>), sizeof(OptionalValue<R>));
+        SkipEmpty<ReduceFunctor> skip{f};
+        return combineProcessResults(local, skip, all, e.getCommunicator()).value;
+    }
+}
+
+template <typename R, typename E, typename ReduceFunctor>
+R reduceExpression(const E& e, ReducePlan<R, ReduceFunctor>& plan) {
+    if (plan.getCommunicator() != e.getCommunicator())
+        throw std::invalid_argument("reduce: plan was created for a different communicator");
+    ProfileScope scope("reduce", PROFILE_CALL);
+    const R local = reduceLocal(e, plan.getFunctor(), plan.getIdentity(), plan.getPartials());
+
+    ProfileScope communication("reduce", PROFILE_COMMUNICATION);
+    communication.addBytes(sizeof(R), sizeof(R));
+    return plan.combine(local);
+}
+
+template <typename R, typename E, typename ReduceFunctor>
+SkeletonFuture<R> reduceExpressionAsync(const E& e, ReduceFunctor& f, const R& identity) {
+    ProfileScope scope("reduceAsync", PROFILE_CALL);
+    const R local = reduceLocal(e, f, identity);
+
+    // only the start of the reduction, the wait is spent in the caller
+    ProfileScope communication("reduceAsync", PROFILE_COMMUNICATION);
+    communication.addBytes(sizeof(R), sizeof(R));
+    return combineProcessResultsAsync(local, f, e.getCommunicator().get());
+}
+
+template <typename R, typename E, typename ReduceFunctor>
+SkeletonFuture<R> reduceExpressionAsync(const E& e, ReduceFunctor& f) {
+    typedef ReduceIdentity<ReduceFunctor, R> Identity;
+    if constexpr (Identity::known) {
+        return reduceExpressionAsync(e, f, Identity::get());
+    } else {
+        ProfileScope scope("reduceAsync", PROFILE_CALL);
+        const OptionalValue<R> local = reduceLocalSeeded<R>(e, f);
+
+        ProfileScope communication("reduceAsync", PROFILE_COMMUNICATION);
+        communication.addBytes(sizeof(OptionalValue<R>), sizeof(OptionalValue<R>));
+        return combineOptionalResultsAsync(local, f, e.getCommunicator().get());
+    }
+}
+
+template <typename T, typename ReduceFunctor>
+ReducePlan<T, ReduceFunctor>::ReducePlan(ReduceFunctor& f, bool all, const Communicator& communicator)
+    : ReducePlan(f, ReduceIdentity<ReduceFunctor, T>::get(), all, communicator) {
+    static_assert(ReduceIdentity<ReduceFunctor, T>::known,
+                  "ReducePlan: the neutral element of the functor is not known, pass it as identity");
+}
+
+template <typename T, typename ReduceFunctor>
+ReducePlan<T, ReduceFunctor>::ReducePlan(ReduceFunctor& f, const T& identity, bool all,
+                                         const Communicator& communicator)
+    : f(f), identity(identity), all(all), communicator(communicator), local(), result(),
+      partials(omp_get_max_threads()) {
+    if (Builtin::available) {
+        op = Builtin::get();
+        datatype = MpiDatatype<T>::get();
+    } else {
+        // the operation carries f in its datatype for the lifetime of the plan
+        userOp.reset(new MpiUserOp<T, ReduceFunctor>(f, FunctorTraits<ReduceFunctor>::commutative));
+        op = userOp->get();
+        datatype = userOp->getDatatype();
+    }
+
+#if MPI_VERSION >= 4
+    if (all)
+        MPI_Allreduce_init(&local, &result, 1, datatype, op, communicator.get(), MPI_INFO_NULL, &request);
+    else
+        MPI_Reduce_init(&local, &result, 1, datatype, op, 0, communicator.get(), MPI_INFO_NULL, &request);
+#endif
+}
+
+template <typename T, typename ReduceFunctor>
+ReducePlan<T, ReduceFunctor>::~ReducePlan() {
+#if MPI_VERSION >= 4
+    MPI_Request_free(&request);
+#endif
+}
+
+template <typename T, typename ReduceFunctor>
+T ReducePlan<T, ReduceFunctor>::combine(const T& local) {
+#if MPI_VERSION >= 4
+    this->local = local;
+    MPI_Start(&request);
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+    return result;
+#else
+    return reduceWithOp(local, op, datatype, all, communicator.get());
+#endif
+}
+
+template <typename T, typename ReduceFunctor>
+std::vector<PaddedValue<T>>& ReducePlan<T, ReduceFunctor>::getPartials() {
+    if ((int)partials.size() < omp_get_max_threads())
+        partials.resize(omp_get_max_threads());
+    return partials;
+}
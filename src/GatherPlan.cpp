@@ -0,0 +1,75 @@
+#include "GatherPlan.hpp"
+
+template <typename T>
+GatherPlan<T>::GatherPlan(const VectorDistribution<T>& v, std::vector<T>& results, bool all)
+    : v(v), results(results), all(all), receives(all || v.rank == 0) {
+    if (receives)
+        results.resize(v.vectorSize);
+    boundLocal = v.localData;
+    boundLocalSize = v.localSize;
+    boundResults = results.data();
+    if (!v.distribution.isContiguous())
+        blocks.resize(receives ? v.vectorSize : 0);
+
+#if MPI_VERSION >= 4
+    request = MPI_REQUEST_NULL;
+    if (v.blockCounts.empty())
+        return;
+
+    T* buffer = v.distribution.isContiguous() ? results.data() : blocks.data();
+    if (all)
+        MPI_Allgatherv_init(v.localData, (int)v.localSize, MpiDatatype<T>::get(),
+                            buffer, v.blockCounts.data(), v.blockDisplacements.data(), MpiDatatype<T>::get(),
+                            v.communicator.get(), MPI_INFO_NULL, &request);
+    else
+        MPI_Gatherv_init(v.localData, (int)v.localSize, MpiDatatype<T>::get(),
+                         buffer, v.blockCounts.data(), v.blockDisplacements.data(), MpiDatatype<T>::get(),
+                         0, v.communicator.get(), MPI_INFO_NULL, &request);
+#endif
+}
+
+template <typename T>
+GatherPlan<T>::~GatherPlan() {
+#if MPI_VERSION >= 4
+    if (request != MPI_REQUEST_NULL)
+        MPI_Request_free(&request);
+#endif
+}
+
+template <typename T>
+void GatherPlan<T>::run() {
+    // the collective may be bound to the local block and the storage of results; all processes throw if
+    // any of them changed, so none is left waiting in the gather
+    bool bound = v.localData == boundLocal && v.localSize == boundLocalSize;
+    if (receives)
+        bound &= results.data() == boundResults && (GlobalIndex)results.size() == v.vectorSize;
+    requireAll(bound, "GatherPlan: the distribution or the results were reallocated after the plan was created",
+               v.communicator);
+
+    // above INT_MAX elements there is nothing to prepare, use the large-count path of the distribution
+    if (v.blockCounts.empty()) {
+        if (all)
+            v.allGatherAsync(results).wait();
+        else
+            v.gatherAsync(results).wait();
+        return;
+    }
+
+    T* buffer = v.distribution.isContiguous() ? results.data() : blocks.data();
+#if MPI_VERSION >= 4
+    MPI_Start(&request);
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+#else
+    if (all)
+        MPI_Allgatherv(v.localData, (int)v.localSize, MpiDatatype<T>::get(),
+                       buffer, v.blockCounts.data(), v.blockDisplacements.data(), MpiDatatype<T>::get(),
+                       v.communicator.get());
+    else
+        MPI_Gatherv(v.localData, (int)v.localSize, MpiDatatype<T>::get(),
+                    buffer, v.blockCounts.data(), v.blockDisplacements.data(), MpiDatatype<T>::get(),
+                    0, v.communicator.get());
+#endif
+
+    if (!v.distribution.isContiguous() && receives)
+        VectorDistribution<T>::restoreGlobalOrder(v.distribution, buffer, results.data());
+}
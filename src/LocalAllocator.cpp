@@ -0,0 +1,32 @@
+#include "LocalAllocator.hpp"
+
+#include <cstdlib>
+#include <sys/mman.h>
+
+template <typename T>
+T* LocalAllocator<T>::allocate(std::size_t n) {
+    std::size_t bytes = n * sizeof(T);
+    std::size_t alignment = alignof(T) > LOCAL_ALIGNMENT ? alignof(T) : LOCAL_ALIGNMENT;
+    bool hugePages = Utils::use_huge_pages && bytes >= HUGE_PAGE_SIZE;
+
+    if (hugePages) {
+        // huge pages have to be aligned and completely owned by the block
+        alignment = HUGE_PAGE_SIZE;
+        bytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+
+    void* p = nullptr;
+    if (posix_memalign(&p, alignment, bytes == 0 ? alignment : bytes) != 0)
+        throw std::bad_alloc();
+
+#ifdef MADV_HUGEPAGE
+    if (hugePages)
+        madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    return static_cast<T*>(p);
+}
+
+template <typename T>
+void LocalAllocator<T>::deallocate(T* p, std::size_t n) noexcept {
+    free(p);
+}
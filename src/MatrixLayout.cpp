@@ -0,0 +1,49 @@
+#include "MatrixLayout.hpp"
+
+#include <stdexcept>
+
+MatrixLayout::MatrixLayout()
+    : rows(0), cols(0), gridRows(0), gridCols(0), gridRow(0), gridCol(0), localRows(0), localCols(0),
+      firstRow(0), firstCol(0), tileSize(1), tileRows(0), tileCols(0) {}
+
+MatrixLayout::MatrixLayout(GlobalIndex rows, GlobalIndex cols, const Communicator& communicator, int gridRows,
+                           GlobalIndex tileSize)
+    : rows(rows), cols(cols), tileSize(tileSize), communicator(communicator) {
+    if (rows < 0 || cols < 0)
+        throw std::invalid_argument("DistributedMatrix: size must not be negative");
+    if (tileSize <= 0)
+        throw std::invalid_argument("DistributedMatrix: tile size has to be positive");
+
+    const int numProcesses = communicator.getSize();
+    if (gridRows < 0 || (gridRows > 0 && numProcesses % gridRows != 0))
+        throw std::invalid_argument("DistributedMatrix: number of grid rows has to divide the number of processes");
+
+    int dims[2] = {gridRows, 0};
+    MPI_Dims_create(numProcesses, 2, dims);
+    this->gridRows = dims[0];
+    gridCols = dims[1];
+
+    grid = communicator.cartesian(this->gridRows, gridCols);
+    rowCommunicator = grid.cartesianSub(false, true);
+    colCommunicator = grid.cartesianSub(true, false);
+
+    // the grid keeps the ranks, so the position follows from the rank
+    const int rank = communicator.getRank();
+    gridRow = rank / gridCols;
+    gridCol = rank % gridCols;
+
+    rowDistribution = Distribution::balancedBlock(rows, this->gridRows);
+    colDistribution = Distribution::balancedBlock(cols, gridCols);
+    localRows = rowDistribution.localSizeOf(gridRow);
+    localCols = colDistribution.localSizeOf(gridCol);
+    firstRow = rowDistribution.firstIndexOf(gridRow);
+    firstCol = colDistribution.firstIndexOf(gridCol);
+
+    tileRows = (localRows + tileSize - 1) / tileSize;
+    tileCols = (localCols + tileSize - 1) / tileSize;
+}
+
+bool MatrixLayout::operator==(const MatrixLayout& other) const {
+    return rows == other.rows && cols == other.cols && gridRows == other.gridRows && gridCols == other.gridCols
+           && tileSize == other.tileSize && communicator == other.communicator;
+}
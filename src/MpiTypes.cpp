@@ -0,0 +1,274 @@
+#include "MpiTypes.hpp"
+
+template <typename T>
+MPI_Datatype MpiDatatype<T>::get() {
+    // created once per element type and kept until MPI_Finalize
+    static MPI_Datatype datatype = [] {
+        MPI_Datatype d;
+        MPI_Type_contiguous(sizeof(T), MPI_BYTE, &d);
+        MPI_Type_commit(&d);
+        return d;
+    }();
+    return datatype;
+}
+
+template <typename T>
+MPI_Datatype createLargeDatatype(GlobalIndex count) {
+    const GlobalIndex chunkSize = GlobalIndex(1) << 20;
+    const GlobalIndex chunks = count / chunkSize;
+    const GlobalIndex rest = count % chunkSize;
+
+    MPI_Datatype chunkType, chunksType, restType, largeType;
+    MPI_Type_contiguous((int)chunkSize, MpiDatatype<T>::get(), &chunkType);
+    MPI_Type_contiguous((int)chunks, chunkType, &chunksType);
+    MPI_Type_contiguous((int)rest, MpiDatatype<T>::get(), &restType);
+
+    // the remainder starts right behind the last full chunk
+    int blockLengths[2] = {1, 1};
+    MPI_Aint displacements[2] = {0, (MPI_Aint)(chunks * chunkSize * sizeof(T))};
+    MPI_Datatype types[2] = {chunksType, restType};
+    MPI_Type_create_struct(2, blockLengths, displacements, types, &largeType);
+    MPI_Type_commit(&largeType);
+
+    MPI_Type_free(&chunkType);
+    MPI_Type_free(&chunksType);
+    MPI_Type_free(&restType);
+    return largeType;
+}
+
+template <typename T, typename ReduceFunctor>
+MpiUserOp<T, ReduceFunctor>::MpiUserOp(ReduceFunctor& f, bool commutative) {
+    MPI_Op_create(&MpiUserOp<T, ReduceFunctor>::apply, commutative, &op);
+    MPI_Type_dup(MpiDatatype<T>::get(), &datatype);
+    MPI_Type_set_attr(datatype, keyval(), &f);
+}
+
+template <typename T, typename ReduceFunctor>
+MpiUserOp<T, ReduceFunctor>::~MpiUserOp() {
+    // owners may outlive terminateSkeletons(), freeing is only allowed before MPI_Finalize
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    if (finalized)
+        return;
+
+    MPI_Op_free(&op);
+    MPI_Type_free(&datatype);
+}
+
+template <typename T, typename ReduceFunctor>
+int MpiUserOp<T, ReduceFunctor>::keyval() {
+    static int key = [] {
+        int k;
+        MPI_Type_create_keyval(MPI_TYPE_NULL_COPY_FN, MPI_TYPE_NULL_DELETE_FN, &k, nullptr);
+        return k;
+    }();
+    return key;
+}
+
+template <typename T, typename ReduceFunctor>
+void MpiUserOp<T, ReduceFunctor>::apply(void* in, void* inout, int* len, MPI_Datatype* datatype) {
+    const T* a = static_cast<const T*>(in);
+    T* b = static_cast<T*>(inout);
+
+    // the functor of this call is attached to its datatype
+    void* attribute = nullptr;
+    int found = 0;
+    MPI_Type_get_attr(*datatype, keyval(), &attribute, &found);
+    ReduceFunctor& f = *static_cast<ReduceFunctor*>(attribute);
+
+    // MPI passes the operand of the lower ranks in "in"
+    for (int i = 0; i < *len; i++) {
+        b[i] = f(a[i], b[i]);
+    }
+}
+
+template <typename T>
+T reduceWithOp(const T& local, MPI_Op op, MPI_Datatype datatype, bool all, MPI_Comm comm) {
+    T result = T();
+
+    if (all)
+        MPI_Allreduce(&local, &result, 1, datatype, op, comm);
+    else
+        MPI_Reduce(&local, &result, 1, datatype, op, 0, comm);
+
+    return result;
+}
+
+template <typename T, typename ReduceFunctor>
+T combineProcessResults(const T& local, ReduceFunctor& f, bool all, MPI_Comm comm) {
+    typedef MpiBuiltinOp<T, typename std::remove_const<ReduceFunctor>::type> Builtin;
+
+    // fast path, let MPI use its predefined operation
+    if (Builtin::available)
+        return reduceWithOp(local, Builtin::get(), MpiDatatype<T>::get(), all, comm);
+
+    MpiUserOp<T, ReduceFunctor> userOp(f, FunctorTraits<ReduceFunctor>::commutative);
+    return reduceWithOp(local, userOp.get(), userOp.getDatatype(), all, comm);
+}
+
+template <typename T, typename ReduceFunctor>
+T exscanProcessResults(const T& local, ReduceFunctor& f, const T& identity, MPI_Comm comm) {
+    typedef MpiBuiltinOp<T, typename std::remove_const<ReduceFunctor>::type> Builtin;
+    T result = identity;
+
+    if (Builtin::available) {
+        MPI_Exscan(&local, &result, 1, MpiDatatype<T>::get(), Builtin::get(), comm);
+    } else {
+        MpiUserOp<T, ReduceFunctor> userOp(f, FunctorTraits<ReduceFunctor>::commutative);
+        MPI_Exscan(&local, &result, 1, userOp.getDatatype(), userOp.get(), comm);
+    }
+
+    // the receive buffer of rank 0 is undefined after MPI_Exscan
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    return rank == 0 ? identity : result;
+}
+
+template <typename T, typename ReduceFunctor>
+T combineProcessResults(const T& local, ReduceFunctor& f, bool all, const Communicator& comm) {
+    if (!Utils::use_shared_windows || !std::is_trivially_copyable<T>::value || !comm.getTopology().consecutive)
+        return combineProcessResults(local, f, all, comm.get());
+
+    // every process owns a slot for its partial result and one for the final result,
+    // the slots are copied bytewise since the window holds no constructed objects
+    const NodeTopology& topology = comm.getTopology();
+    SharedWindow& scratch = topology.getScratch(2 * sizeof(T));
+    std::memcpy(scratch.getLocal(), &local, sizeof(T));
+    scratch.sync();
+
+    T result = T();
+    if (topology.isLeader()) {
+        // fold the partials of the node in rank order
+        T partial;
+        std::memcpy(&result, scratch.getSegment(0), sizeof(T));
+        for (int i = 1; i < topology.node.getSize(); i++) {
+            std::memcpy(&partial, scratch.getSegment(i), sizeof(T));
+            result = f(result, partial);
+        }
+
+        result = combineProcessResults(result, f, all, topology.leaders.get());
+        if (all)
+            std::memcpy(static_cast<char*>(scratch.getLocal()) + sizeof(T), &result, sizeof(T));
+    }
+
+    // publishes the result and keeps the partial slots until the leader has read them
+    scratch.sync();
+    if (all && !topology.isLeader())
+        std::memcpy(&result, static_cast<char*>(scratch.getSegment(0)) + sizeof(T), sizeof(T));
+    return result;
+}
+
+template <typename T, typename ReduceFunctor>
+SkeletonFuture<T> combineProcessResultsAsync(const T& local, ReduceFunctor& f, MPI_Comm comm) {
+    typedef MpiBuiltinOp<T, typename std::remove_const<ReduceFunctor>::type> Builtin;
+
+    // MPI reads and writes the buffers until the request has completed, so they live on the heap
+    struct State {
+        T local;
+        T result;
+        std::unique_ptr<MpiUserOp<T, ReduceFunctor>> userOp;
+    };
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->local = local;
+    state->result = T();
+
+    MPI_Op op;
+    MPI_Datatype datatype = MpiDatatype<T>::get();
+    if (Builtin::available) {
+        op = Builtin::get();
+    } else {
+        state->userOp.reset(new MpiUserOp<T, ReduceFunctor>(f, FunctorTraits<ReduceFunctor>::commutative));
+        op = state->userOp->get();
+        datatype = state->userOp->getDatatype();
+    }
+
+    SkeletonFuture<T> future(&state->result);
+    MPI_Iallreduce(&state->local, &state->result, 1, datatype, op, comm, future.addRequest());
+    future.keepAlive(state);
+    return future;
+}
+
+template <typename T, typename ReduceFunctor>
+SkeletonFuture<T> combineOptionalResultsAsync(const OptionalValue<T>& local, ReduceFunctor& f, MPI_Comm comm) {
+    typedef SkipEmpty<ReduceFunctor> Skip;
+
+    // the operation refers to the wrapper, so it lives in the state as well
+    struct State {
+        OptionalValue<T> local;
+        OptionalValue<T> result;
+        Skip skip;
+        std::unique_ptr<MpiUserOp<OptionalValue<T>, Skip>> userOp;
+    };
+    std::shared_ptr<State> state(new State{local, {T(), false}, Skip{f}, nullptr});
+    state->userOp.reset(new MpiUserOp<OptionalValue<T>, Skip>(state->skip, FunctorTraits<Skip>::commutative));
+
+    SkeletonFuture<T> future(&state->result.value);
+    MPI_Iallreduce(&state->local, &state->result, 1, state->userOp->getDatatype(), state->userOp->get(), comm,
+                   future.addRequest());
+    future.keepAlive(state);
+    return future;
+}
+
+template <typename T, typename ReduceFunctor>
+void combineProcessArrays(const T* local, T* result, GlobalIndex count, ReduceFunctor& f, int root, MPI_Comm comm) {
+    typedef MpiBuiltinOp<T, typename std::remove_const<ReduceFunctor>::type> Builtin;
+
+    std::unique_ptr<MpiUserOp<T, ReduceFunctor>> userOp;
+    MPI_Op op;
+    MPI_Datatype datatype = MpiDatatype<T>::get();
+    if (Builtin::available) {
+        op = Builtin::get();
+    } else {
+        // MpiUserOp::apply folds the whole array, so one operation serves all elements
+        userOp.reset(new MpiUserOp<T, ReduceFunctor>(f, FunctorTraits<ReduceFunctor>::commutative));
+        op = userOp->get();
+        datatype = userOp->getDatatype();
+    }
+
+    for (GlobalIndex done = 0; done < count; done += INT_MAX) {
+        const int n = (int)std::min<GlobalIndex>(count - done, INT_MAX);
+        MPI_Reduce(local + done, result == nullptr ? nullptr : result + done, n, datatype, op, root, comm);
+    }
+}
+
+template <typename T>
+void redistributeRange(const T* data, GlobalIndex first, GlobalIndex count, T* out, GlobalIndex outFirst,
+                       GlobalIndex outCount, MPI_Comm comm) {
+    int numProcesses;
+    MPI_Comm_size(comm, &numProcesses);
+
+    // held and requested range of every process
+    GlobalIndex mine[4] = {first, count, outFirst, outCount};
+    std::vector<GlobalIndex> ranges(4 * numProcesses);
+    MPI_Allgather(mine, 4, MPI_INT64_T, ranges.data(), 4, MPI_INT64_T, comm);
+
+    auto overlap = [] (GlobalIndex aFirst, GlobalIndex aCount, GlobalIndex bFirst, GlobalIndex bCount,
+                       GlobalIndex& begin) {
+        begin = std::max(aFirst, bFirst);
+        return std::max<GlobalIndex>(0, std::min(aFirst + aCount, bFirst + bCount) - begin);
+    };
+
+    std::vector<int> sendCounts(numProcesses), sendDisplacements(numProcesses);
+    std::vector<int> receiveCounts(numProcesses), receiveDisplacements(numProcesses);
+    bool fits = true;
+    for (int p = 0; p < numProcesses; p++) {
+        const GlobalIndex* other = &ranges[4 * p];
+        GlobalIndex begin;
+        const GlobalIndex sent = overlap(first, count, other[2], other[3], begin);
+        const GlobalIndex sentOffset = begin - first;
+        const GlobalIndex received = overlap(other[0], other[1], outFirst, outCount, begin);
+        const GlobalIndex receivedOffset = begin - outFirst;
+        fits &= sent <= INT_MAX && received <= INT_MAX && sentOffset <= INT_MAX && receivedOffset <= INT_MAX;
+
+        sendCounts[p] = (int)sent;
+        sendDisplacements[p] = sent > 0 ? (int)sentOffset : 0;
+        receiveCounts[p] = (int)received;
+        receiveDisplacements[p] = received > 0 ? (int)receivedOffset : 0;
+    }
+
+    // every process throws if one of them cannot describe its exchange with int counts
+    requireAll(fits, "redistributeRange: ranges of more than INT_MAX elements", Communicator(comm));
+
+    MPI_Alltoallv(data, sendCounts.data(), sendDisplacements.data(), MpiDatatype<T>::get(),
+                  out, receiveCounts.data(), receiveDisplacements.data(), MpiDatatype<T>::get(), comm);
+}
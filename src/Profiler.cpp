@@ -0,0 +1,168 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+bool Profiler::enabled = false;
+std::string Profiler::tracePrefix;
+size_t Profiler::maxEvents = 0;
+double Profiler::origin = 0;
+thread_local const char* Profiler::current = nullptr;
+std::vector<SkeletonProfile> Profiler::profiles;
+std::vector<Profiler::Event> Profiler::events;
+
+void Profiler::enable(const std::string& prefix, size_t maxTraceEvents) {
+    tracePrefix = prefix;
+    maxEvents = maxTraceEvents;
+    if (!enabled)
+        origin = MPI_Wtime();
+    enabled = true;
+}
+
+void Profiler::disable() {
+    enabled = false;
+}
+
+void Profiler::reset() {
+    #pragma omp critical(profiler)
+    {
+        profiles.clear();
+        events.clear();
+        origin = MPI_Wtime();
+    }
+}
+
+SkeletonProfile& Profiler::profileOf(const char* skeleton) {
+    auto it = std::lower_bound(profiles.begin(), profiles.end(), skeleton,
+                               [] (const SkeletonProfile& p, const char* name) { return p.skeleton < name; });
+    if (it == profiles.end() || it->skeleton != skeleton) {
+        it = profiles.insert(it, SkeletonProfile());
+        it->skeleton = skeleton;
+    }
+    return *it;
+}
+
+void Profiler::addEvent(const Event& event) {
+    if (events.size() < maxEvents)
+        events.push_back(event);
+}
+
+void Profiler::record(const char* skeleton, ProfilePhase phase, double start, double end,
+                      long long bytesSent, long long bytesReceived) {
+    // skeletons may run concurrently on different communicators with MPI_THREAD_MULTIPLE
+    #pragma omp critical(profiler)
+    {
+        SkeletonProfile& profile = profileOf(skeleton);
+        if (phase == PROFILE_CALL) {
+            profile.calls++;
+            profile.time += end - start;
+        } else {
+            profile.communicationTime += end - start;
+        }
+        profile.bytesSent += bytesSent;
+        profile.bytesReceived += bytesReceived;
+
+        addEvent({skeleton, phase == PROFILE_CALL ? "skeleton" : "communication", start - origin, end - start,
+                  omp_get_thread_num(), bytesSent, bytesReceived});
+    }
+}
+
+void Profiler::recordThreads(const char* skeleton, const double* starts, const double* ends, int numThreads) {
+    if (skeleton == nullptr)
+        skeleton = "parallel";
+
+    double slowest = 0;
+    double sum = 0;
+    for (int t = 0; t < numThreads; t++) {
+        double time = ends[t * THREAD_STRIDE] - starts[t * THREAD_STRIDE];
+        slowest = std::max(slowest, time);
+        sum += time;
+    }
+
+    // omp_get_wtime and MPI_Wtime may count from different points in time
+    double shift = MPI_Wtime() - omp_get_wtime();
+
+    #pragma omp critical(profiler)
+    {
+        SkeletonProfile& profile = profileOf(skeleton);
+        profile.parallelRegions++;
+        profile.threadImbalance += sum > 0 ? slowest / (sum / numThreads) : 1;
+
+        for (int t = 0; t < numThreads; t++) {
+            double start = starts[t * THREAD_STRIDE] + shift;
+            addEvent({skeleton, "thread", start - origin, ends[t * THREAD_STRIDE] - starts[t * THREAD_STRIDE],
+                      t, 0, 0});
+        }
+    }
+}
+
+std::vector<SkeletonProfile> Profiler::getProfiles() {
+    std::vector<SkeletonProfile> result;
+    #pragma omp critical(profiler)
+    result = profiles;
+    return result;
+}
+
+SkeletonProfile Profiler::getProfile(const std::string& skeleton) {
+    SkeletonProfile result;
+    result.skeleton = skeleton;
+    #pragma omp critical(profiler)
+    {
+        for (const SkeletonProfile& profile : profiles) {
+            if (profile.skeleton == skeleton)
+                result = profile;
+        }
+    }
+    return result;
+}
+
+RankImbalance Profiler::compareRanks(const std::string& skeleton, const Communicator& communicator) {
+    SkeletonProfile profile = getProfile(skeleton);
+
+    struct { double value; int rank; } compute = {profile.getComputeTime(), communicator.getRank()};
+    double sums[2] = {profile.getComputeTime(), profile.communicationTime};
+    RankImbalance result;
+
+    MPI_Allreduce(MPI_IN_PLACE, &compute, 1, MPI_DOUBLE_INT, MPI_MAXLOC, communicator.get());
+    MPI_Allreduce(&profile.communicationTime, &result.maxCommunication, 1, MPI_DOUBLE, MPI_MAX, communicator.get());
+    MPI_Allreduce(MPI_IN_PLACE, sums, 2, MPI_DOUBLE, MPI_SUM, communicator.get());
+
+    result.maxCompute = compute.value;
+    result.slowestRank = compute.rank;
+    result.meanCompute = sums[0] / communicator.getSize();
+    result.meanCommunication = sums[1] / communicator.getSize();
+    return result;
+}
+
+void Profiler::writeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error("Profiler: cannot write trace " + path);
+
+    int rank = Utils::proc_rank < 0 ? 0 : Utils::proc_rank;
+
+    // complete events ("ph": "X") with microsecond time stamps, one trace process per MPI rank
+    out << "{\"traceEvents\": [";
+    #pragma omp critical(profiler)
+    {
+        for (size_t i = 0; i < events.size(); i++) {
+            const Event& e = events[i];
+            out << (i == 0 ? "\n" : ",\n")
+                << "  {\"name\": \"" << e.name << "\", \"cat\": \"" << e.category << "\", \"ph\": \"X\""
+                << ", \"ts\": " << e.start * 1e6 << ", \"dur\": " << e.duration * 1e6
+                << ", \"pid\": " << rank << ", \"tid\": " << e.thread;
+            if (std::strcmp(e.category, "thread") != 0)
+                out << ", \"args\": {\"bytesSent\": " << e.bytesSent << ", \"bytesReceived\": " << e.bytesReceived << "}";
+            out << "}";
+        }
+    }
+    out << "\n],\n\"displayTimeUnit\": \"ms\"}\n";
+}
+
+void Profiler::finish() {
+    if (enabled && !tracePrefix.empty())
+        writeTrace(tracePrefix + "." + std::to_string(Utils::proc_rank) + ".json");
+    enabled = false;
+}
@@ -0,0 +1,46 @@
+#include "SharedWindow.hpp"
+
+SharedWindow::SharedWindow(std::size_t bytes, const Communicator& node) : node(node), contiguous(true) {
+    char* local = nullptr;
+    MPI_Win_allocate_shared((MPI_Aint)bytes, 1, MPI_INFO_NULL, node.get(), &local, &window);
+    // passive target epoch for the lifetime of the window, synchronized with MPI_Win_sync
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+
+    const int nodeSize = node.getSize();
+    segments.resize(nodeSize);
+    sizes.resize(nodeSize);
+
+    // empty segments may not have an address, they are placed behind their predecessor
+    char* next = nullptr;
+    for (int i = 0; i < nodeSize; i++) {
+        MPI_Aint size;
+        int displacementUnit;
+        MPI_Win_shared_query(window, i, &size, &displacementUnit, &segments[i]);
+        sizes[i] = (std::size_t)size;
+
+        if (sizes[i] == 0) {
+            segments[i] = next;
+            continue;
+        }
+        if (next != nullptr && segments[i] != next)
+            contiguous = false;
+        next = segments[i] + sizes[i];
+    }
+}
+
+SharedWindow::~SharedWindow() {
+    // windows may outlive terminateSkeletons() in static storage
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    if (finalized)
+        return;
+
+    MPI_Win_unlock_all(window);
+    MPI_Win_free(&window);
+}
+
+void SharedWindow::sync() const {
+    MPI_Win_sync(window);
+    MPI_Barrier(node.get());
+    MPI_Win_sync(window);
+}
@@ -0,0 +1,75 @@
+#include "SkeletonRequest.hpp"
+
+#include <utility>
+
+SkeletonRequest::SkeletonRequest() : completed(false) {}
+
+SkeletonRequest::SkeletonRequest(SkeletonRequest&& other) noexcept
+    : requests(std::move(other.requests)), completion(std::move(other.completion)),
+      state(std::move(other.state)), completed(other.completed) {
+    other.requests.clear();
+    other.completion = nullptr;
+    other.completed = true;
+}
+
+SkeletonRequest& SkeletonRequest::operator=(SkeletonRequest&& other) noexcept {
+    if (this != &other) {
+        wait();
+        requests = std::move(other.requests);
+        completion = std::move(other.completion);
+        state = std::move(other.state);
+        completed = other.completed;
+        other.requests.clear();
+        other.completion = nullptr;
+        other.completed = true;
+    }
+    return *this;
+}
+
+SkeletonRequest::~SkeletonRequest() {
+    wait();
+}
+
+void SkeletonRequest::wait() {
+    if (completed)
+        return;
+
+    MPI_Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    complete();
+}
+
+bool SkeletonRequest::test() {
+    if (completed)
+        return true;
+
+    int flag = 0;
+    MPI_Testall((int)requests.size(), requests.data(), &flag, MPI_STATUSES_IGNORE);
+    if (flag)
+        complete();
+    return flag != 0;
+}
+
+MPI_Request* SkeletonRequest::addRequest() {
+    // requests are only handed to MPI right away, so growing the vector is safe
+    requests.push_back(MPI_REQUEST_NULL);
+    return &requests.back();
+}
+
+void SkeletonRequest::keepAlive(std::shared_ptr<void> state) {
+    this->state = std::move(state);
+}
+
+void SkeletonRequest::onComplete(std::function<void()> f) {
+    completion = std::move(f);
+}
+
+void SkeletonRequest::complete() {
+    completed = true;
+    if (completion)
+        completion();
+    collect();
+
+    // frees user operations and buffers right away instead of with the handle
+    completion = nullptr;
+    state.reset();
+}
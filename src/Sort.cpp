@@ -0,0 +1,198 @@
+#include "Sort.hpp"
+
+/**
+ * \brief Merges the parts [begin[r], end[r]) of the sorted runs into \em out.
+ */
+template <typename T, typename Comparator>
+void mergeRunParts(const std::vector<SortedRun<T>>& runs, const GlobalIndex* begin, const GlobalIndex* end,
+                   T* out, Comparator& comp) {
+    auto less = [&comp] (const T& a, const T& b) { return comp(a, b); };
+    const int k = (int)runs.size();
+
+    if (k == 2) {
+        std::merge(runs[0].data + begin[0], runs[0].data + end[0], runs[1].data + begin[1], runs[1].data + end[1],
+                   out, less);
+        return;
+    }
+
+    // heap of the runs with elements left, the run with the smallest head on top and the lower run first
+    // among equal heads
+    std::vector<GlobalIndex> next(begin, begin + k);
+    auto after = [&] (int a, int b) {
+        const T& x = runs[a].data[next[a]];
+        const T& y = runs[b].data[next[b]];
+        return comp(y, x) || (!comp(x, y) && a > b);
+    };
+    std::vector<int> heap;
+    for (int r = 0; r < k; r++) {
+        if (next[r] < end[r])
+            heap.push_back(r);
+    }
+    std::make_heap(heap.begin(), heap.end(), after);
+
+    while (heap.size() > 1) {
+        std::pop_heap(heap.begin(), heap.end(), after);
+        const int r = heap.back();
+        *out++ = runs[r].data[next[r]++];
+        if (next[r] < end[r])
+            std::push_heap(heap.begin(), heap.end(), after);
+        else
+            heap.pop_back();
+    }
+
+    if (!heap.empty())
+        std::copy(runs[heap[0]].data + next[heap[0]], runs[heap[0]].data + end[heap[0]], out);
+}
+
+template <typename T, typename Comparator>
+void mergeRuns(const std::vector<SortedRun<T>>& runs, T* out, Comparator& comp) {
+    auto less = [&comp] (const T& a, const T& b) { return comp(a, b); };
+    const int k = (int)runs.size();
+    GlobalIndex total = 0;
+    for (const SortedRun<T>& run : runs) {
+        total += run.size;
+    }
+    if (total == 0)
+        return;
+
+    // small merges are not worth a parallel region
+    const int parts = total < (GlobalIndex)omp_get_max_threads() * 4096 ? 1 : omp_get_max_threads();
+
+    // bounds[t * k + r] is the position in run r where part t starts
+    std::vector<GlobalIndex> bounds((parts + 1) * k, 0);
+    for (int r = 0; r < k; r++) {
+        bounds[parts * k + r] = runs[r].size;
+    }
+
+    if (parts > 1) {
+        // regular samples of every run in proportion to its size
+        std::vector<T> samples;
+        for (const SortedRun<T>& run : runs) {
+            const GlobalIndex count = run.size * 8 * parts / total + 1;
+            for (GlobalIndex i = 0; i < count && run.size > 0; i++) {
+                samples.push_back(run.data[i * run.size / count]);
+            }
+        }
+        std::sort(samples.begin(), samples.end(), less);
+
+        for (int t = 1; t < parts; t++) {
+            const T& splitter = samples[t * samples.size() / parts];
+            for (int r = 0; r < k; r++) {
+                bounds[t * k + r] = std::lower_bound(runs[r].data, runs[r].data + runs[r].size, splitter, less)
+                                    - runs[r].data;
+            }
+        }
+    }
+
+    // every part starts behind the elements of all runs before it
+    std::vector<GlobalIndex> outOffsets(parts, 0);
+    for (int t = 0; t < parts; t++) {
+        for (int r = 0; r < k; r++) {
+            outOffsets[t] += bounds[t * k + r];
+        }
+    }
+
+    ThreadTimer timer;
+    #pragma omp parallel if (parts > 1)
+    {
+        timer.start();
+        #pragma omp for schedule(static) nowait
+        for (int t = 0; t < parts; t++) {
+            mergeRunParts(runs, &bounds[t * k], &bounds[(t + 1) * k], out + outOffsets[t], comp);
+        }
+        timer.stop();
+    }
+}
+
+template <typename T, typename Comparator>
+void parallelSort(T* data, GlobalIndex n, T* out, Comparator& comp) {
+    auto less = [&comp] (const T& a, const T& b) { return comp(a, b); };
+    int numThreads = 1;
+    ThreadTimer timer;
+
+    #pragma omp parallel
+    {
+        timer.start();
+        if (omp_get_thread_num() == 0)
+            numThreads = omp_get_num_threads();
+
+        GlobalIndex begin, end;
+        staticRange(n, omp_get_thread_num(), omp_get_num_threads(), begin, end);
+        std::sort(data + begin, data + end, less);
+        timer.stop();
+    }
+
+    std::vector<SortedRun<T>> runs(numThreads);
+    for (int t = 0; t < numThreads; t++) {
+        GlobalIndex begin, end;
+        staticRange(n, t, numThreads, begin, end);
+        runs[t] = {data + begin, end - begin};
+    }
+    mergeRuns(runs, out, comp);
+}
+
+template <typename T, typename Comparator>
+std::vector<T> selectSplitters(const T* sorted, GlobalIndex n, GlobalIndex globalSize, Comparator& comp,
+                               const Communicator& communicator) {
+    auto less = [&comp] (const T& a, const T& b) { return comp(a, b); };
+    const int numProcesses = communicator.getSize();
+    std::vector<T> splitters;
+    if (numProcesses == 1 || globalSize == 0)
+        return splitters;
+
+    // the same stride on every process, so larger blocks contribute more samples
+    const GlobalIndex stride = std::max<GlobalIndex>(1, globalSize / (SORT_SAMPLES_PER_PROCESS * numProcesses));
+    std::vector<T> samples;
+    for (GlobalIndex i = stride / 2; i < n; i += stride) {
+        samples.push_back(sorted[i]);
+    }
+
+    int count = (int)samples.size();
+    std::vector<int> counts(numProcesses), displacements(numProcesses);
+    MPI_Allgather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, communicator.get());
+    int total = 0;
+    for (int p = 0; p < numProcesses; p++) {
+        displacements[p] = total;
+        total += counts[p];
+    }
+
+    std::vector<T> all(total);
+    MPI_Allgatherv(samples.data(), count, MpiDatatype<T>::get(), all.data(), counts.data(), displacements.data(),
+                   MpiDatatype<T>::get(), communicator.get());
+    std::sort(all.begin(), all.end(), less);
+
+    for (int p = 1; p < numProcesses && total > 0; p++) {
+        splitters.push_back(all[(GlobalIndex)p * total / numProcesses]);
+    }
+    return splitters;
+}
+
+template <typename T, typename Comparator>
+std::vector<GlobalIndex> splitPositions(const T* sorted, GlobalIndex n, const std::vector<T>& splitters,
+                                        Comparator& comp) {
+    auto less = [&comp] (const T& a, const T& b) { return comp(a, b); };
+    const size_t numSplitters = splitters.size();
+    std::vector<GlobalIndex> bounds(numSplitters + 2);
+    bounds[0] = 0;
+    bounds[numSplitters + 1] = n;
+
+    for (size_t a = 0; a < numSplitters;) {
+        // splitters a..b are equal
+        size_t b = a;
+        while (b + 1 < numSplitters && !comp(splitters[a], splitters[b + 1])) {
+            b++;
+        }
+
+        if (a == b) {
+            bounds[a + 1] = std::upper_bound(sorted, sorted + n, splitters[a], less) - sorted;
+        } else {
+            const GlobalIndex low = std::lower_bound(sorted, sorted + n, splitters[a], less) - sorted;
+            const GlobalIndex high = std::upper_bound(sorted + low, sorted + n, splitters[a], less) - sorted;
+            for (size_t s = a; s <= b; s++) {
+                bounds[s + 1] = low + (high - low) * (GlobalIndex)(s - a + 1) / (GlobalIndex)(b - a + 2);
+            }
+        }
+        a = b + 1;
+    }
+    return bounds;
+}
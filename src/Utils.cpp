@@ -1,15 +1,44 @@
 #include "Utils.hpp"
+#include "Profiler.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
 
 int Utils::proc_rank = -1;
 int Utils::num_procs;
+int Utils::thread_level = MPI_THREAD_SINGLE;
+bool Utils::use_huge_pages = false;
+bool Utils::use_shared_windows = false;
 
-void initSkeletons(int argc, char **argv) {
-    // Initialize MPI environment
-    MPI_Init(&argc, &argv);
+void initSkeletons(int argc, char **argv, int threadLevel) {
+    // Initialize MPI environment, MPI may provide more or less thread support than requested
+    MPI_Init_thread(&argc, &argv, threadLevel, &Utils::thread_level);
     MPI_Comm_size(MPI_COMM_WORLD, &Utils::num_procs);
     MPI_Comm_rank(MPI_COMM_WORLD, &Utils::proc_rank);
+
+    requireThreadLevel(MPI_THREAD_FUNNELED, "initSkeletons");
+
+    // SKELETON_TRACE=<prefix> profiles the whole run and writes <prefix>.<rank>.json
+    const char* tracePrefix = std::getenv("SKELETON_TRACE");
+    if (tracePrefix != nullptr && *tracePrefix != '\0')
+        Profiler::enable(tracePrefix);
+}
+
+void requireThreadLevel(int threadLevel, const char* skeleton) {
+    if (Utils::thread_level < threadLevel)
+        throw std::runtime_error(std::string(skeleton) + ": MPI does not provide the required thread support level");
+}
+
+void staticRange(GlobalIndex n, int thread, int numThreads, GlobalIndex& begin, GlobalIndex& end) {
+    // the first n % numThreads threads get one additional iteration
+    GlobalIndex chunk = n / numThreads;
+    GlobalIndex remainder = n % numThreads;
+    begin = chunk * thread + (thread < remainder ? thread : remainder);
+    end = begin + chunk + (thread < remainder ? 1 : 0);
 }
 
 void terminateSkeletons() {
+    Profiler::finish();
     MPI_Finalize();
 }
@@ -2,225 +2,1795 @@
 
 template <typename T>
 VectorDistribution<T>::VectorDistribution()
-    : numProcesses(0), rank(0), vectorSize(0), localSize(0), remainingSize(0) {}
+    : numProcesses(0), rank(0), vectorSize(0), localSize(0), firstIndex(0), localData(nullptr) {}
 
 template <typename T>
-VectorDistribution<T>::VectorDistribution(const VectorDistribution<T> &cs) : vectorSize(cs.vectorSize) {
+VectorDistribution<T>::VectorDistribution(const VectorDistribution<T> &cs)
+    : distribution(cs.distribution), communicator(cs.communicator) {
     init();
+    // copy in parallel, which is also the first touch of the new block
+    copyLocal(cs);
+}
+
+template <typename T>
+VectorDistribution<T>::VectorDistribution(VectorDistribution<T> &&other) noexcept
+    : numProcesses(other.numProcesses), rank(other.rank), vectorSize(other.vectorSize), localSize(other.localSize),
+      firstIndex(other.firstIndex), distribution(std::move(other.distribution)), communicator(other.communicator),
+      blockCounts(std::move(other.blockCounts)), blockDisplacements(std::move(other.blockDisplacements)),
+      localVector(std::move(other.localVector)), window(std::move(other.window)), localData(other.localData) {
+    other.vectorSize = other.localSize = 0;
+    other.localData = nullptr;
+}
 
-    localVector = cs.localVector;
+template <typename T>
+VectorDistribution<T>::VectorDistribution(GlobalIndex size, const Communicator& communicator)
+    : distribution(Distribution::balancedBlock(size, communicator.getSize())), communicator(communicator) {
+    init();
+    firstTouch();
 }
 
 template <typename T>
-VectorDistribution<T>::VectorDistribution(int size) : vectorSize(size) {
+VectorDistribution<T>::VectorDistribution(const Distribution& distribution, const Communicator& communicator)
+    : distribution(distribution), communicator(communicator) {
     init();
+    firstTouch();
 }
 
 template <typename T>
-VectorDistribution<T>::VectorDistribution(std::vector<T>& vector) : vectorSize((int)vector.size()) {
+VectorDistribution<T>::VectorDistribution(std::vector<T>& vector, const Communicator& communicator)
+    : distribution(Distribution::balancedBlock((GlobalIndex)vector.size(), communicator.getSize())),
+      communicator(communicator) {
     init();
     this->scatterData(vector);
 }
 
+template <typename T>
+VectorDistribution<T>::VectorDistribution(GlobalIndex size, const std::vector<T>& vector, int root,
+                                          const Communicator& communicator)
+    : distribution(Distribution::balancedBlock(size, communicator.getSize())), communicator(communicator) {
+    init();
+    firstTouch();
+    this->scatterData(vector, root);
+}
+
+template <typename T>
+template <typename Generator, typename>
+VectorDistribution<T>::VectorDistribution(GlobalIndex size, Generator f, const Communicator& communicator)
+    : VectorDistribution(Distribution::balancedBlock(size, communicator.getSize()), f, communicator) {}
+
+template <typename T>
+template <typename Generator, typename>
+VectorDistribution<T>::VectorDistribution(const Distribution& distribution, Generator f,
+                                          const Communicator& communicator)
+    : distribution(distribution), communicator(communicator) {
+    init();
+    T* local = localData;
+
+    if (distribution.isContiguous()) {
+        #pragma omp parallel for schedule(static)
+        for (GlobalIndex i = 0; i < localSize; i++) {
+            local[i] = f(firstIndex + i);
+        }
+    } else {
+        #pragma omp parallel for schedule(static)
+        for (GlobalIndex i = 0; i < localSize; i++) {
+            local[i] = f(distribution.globalIndex(rank, i));
+        }
+    }
+}
+
+template <typename T>
+template <typename Derived, typename R>
+VectorDistribution<T>::VectorDistribution(const SkeletonExpression<Derived, R>& e)
+    : distribution(e.derived().getDistribution()), communicator(e.derived().getCommunicator()) {
+    init();
+    evaluateExpression(e.derived(), localData);
+}
+
+template <typename T>
+template <typename Derived, typename R>
+VectorDistribution<T>& VectorDistribution<T>::operator=(const SkeletonExpression<Derived, R>& e) {
+    // only (re)allocate if the layout changes, repeated assignments reuse the local block
+    if (numProcesses == 0 || distribution != e.derived().getDistribution()
+        || communicator != e.derived().getCommunicator()) {
+        distribution = e.derived().getDistribution();
+        communicator = e.derived().getCommunicator();
+        init();
+    }
+    evaluateExpression(e.derived(), localData);
+    return *this;
+}
+
 template <typename T>
 VectorDistribution<T>::~VectorDistribution() {
     localVector.clear();
 }
 
+template <typename T>
+VectorDistribution<T>& VectorDistribution<T>::operator=(const VectorDistribution<T> &cs) {
+    if (this != &cs) {
+        // the local block keeps its capacity, no allocation if the block fits
+        if (numProcesses == 0 || distribution != cs.distribution || communicator != cs.communicator) {
+            distribution = cs.distribution;
+            communicator = cs.communicator;
+            init();
+        }
+        copyLocal(cs);
+    }
+    return *this;
+}
+
+template <typename T>
+VectorDistribution<T>& VectorDistribution<T>::operator=(VectorDistribution<T> &&other) noexcept {
+    // moving the block into itself and clearing the source would lose it
+    if (this == &other)
+        return *this;
+
+    numProcesses = other.numProcesses;
+    rank = other.rank;
+    vectorSize = other.vectorSize;
+    localSize = other.localSize;
+    firstIndex = other.firstIndex;
+    distribution = std::move(other.distribution);
+    communicator = other.communicator;
+    blockCounts = std::move(other.blockCounts);
+    blockDisplacements = std::move(other.blockDisplacements);
+    localVector = std::move(other.localVector);
+    window = std::move(other.window);
+    localData = other.localData;
+    other.vectorSize = other.localSize = 0;
+    other.localData = nullptr;
+    return *this;
+}
+
 template <typename T>
 void VectorDistribution<T>::init() {
-    numProcesses = Utils::num_procs;
-    rank = Utils::proc_rank;
+    numProcesses = communicator.getSize();
+    rank = communicator.getRank();
+
+    if (distribution.getNumProcesses() != numProcesses)
+        throw std::invalid_argument("VectorDistribution: distribution does not match the number of processes");
+    // distributions created inside a parallel region communicate concurrently with other threads
+    if (omp_in_parallel())
+        requireThreadLevel(MPI_THREAD_MULTIPLE, "VectorDistribution");
+
+    // take size and position of the local block from the distribution
+    vectorSize = distribution.getSize();
+    localSize = distribution.localSizeOf(rank);
+    firstIndex = distribution.firstIndexOf(rank);
+
+    // counts and displacements of the collectives only depend on the layout, compute them once
+    blockCounts.clear();
+    blockDisplacements.clear();
+    if (vectorSize <= INT_MAX) {
+        for (int i = 0; i < numProcesses; i++) {
+            blockCounts.push_back((int)distribution.localSizeOf(i));
+            blockDisplacements.push_back((int)distribution.offsetOf(i));
+        }
+    }
+
+    // free the old block first, so that a reallocation does not copy it
+    window.reset();
+    localVector.clear();
 
-    // calculate localSize for each process
-    localSize = vectorSize / numProcesses;
-    remainingSize = vectorSize % numProcesses;
+    if (Utils::use_shared_windows && std::is_trivially_copyable<T>::value) {
+        localVector.shrink_to_fit();
+        window.reset(new SharedWindow(localSize * sizeof(T), communicator.getTopology().node));
+        localData = static_cast<T*>(window->getLocal());
+    } else {
+        localVector.resize(localSize);
+        localData = localVector.data();
+    }
+}
+
+template <typename T>
+void VectorDistribution<T>::firstTouch() {
+    T* local = localData;
 
-    // set first index befor adjusting last process vectorSize
-    firstIndex = rank * localSize;
-    // set add remainingSize of last process
-    if (rank == numProcesses - 1) {
-        localSize += remainingSize;
+    #pragma omp parallel for schedule(static)
+    for (GlobalIndex i = 0; i < localSize; i++) {
+        local[i] = T();
     }
+}
+
+template <typename T>
+void VectorDistribution<T>::copyLocal(const VectorDistribution<T>& cs) {
+    T* local = localData;
+    const T* source = cs.localData;
 
-    localVector.resize(localSize);
+    #pragma omp parallel for schedule(static)
+    for (GlobalIndex i = 0; i < localSize; i++) {
+        local[i] = source[i];
+    }
 }
 
 template<typename T>
-T VectorDistribution<T>::getLocal(int localIndex) {
-    return localVector[localIndex];
+T VectorDistribution<T>::getLocal(GlobalIndex localIndex) const {
+    return localData[localIndex];
+}
+
+template <typename T>
+const Distribution& VectorDistribution<T>::getDistribution() const {
+    return distribution;
+}
+
+template <typename T>
+const Communicator& VectorDistribution<T>::getCommunicator() const {
+    return communicator;
+}
+
+template <typename T>
+T* VectorDistribution<T>::getLocalData() {
+    return localData;
+}
+
+template <typename T>
+const T* VectorDistribution<T>::getLocalData() const {
+    return localData;
 }
 
 template <typename T>
-void VectorDistribution<T>::setLocal(int localIndex, const T& value) {
-    localVector[localIndex] = value;
+GlobalIndex VectorDistribution<T>::getLocalSize() const {
+    return localSize;
+}
+
+template <typename T>
+GlobalIndex VectorDistribution<T>::getSize() const {
+    return vectorSize;
+}
+
+template <typename T>
+GlobalIndex VectorDistribution<T>::getFirstIndex() const {
+    return firstIndex;
+}
+
+template <typename T>
+T* VectorDistribution<T>::begin() {
+    return localData;
+}
+
+template <typename T>
+T* VectorDistribution<T>::end() {
+    return localData + localSize;
+}
+
+template <typename T>
+const T* VectorDistribution<T>::begin() const {
+    return localData;
+}
+
+template <typename T>
+const T* VectorDistribution<T>::end() const {
+    return localData + localSize;
+}
+
+template <typename T>
+void VectorDistribution<T>::setLocal(GlobalIndex localIndex, const T& value) {
+    localData[localIndex] = value;
 }
 
 template <typename T>
 void VectorDistribution<T>::scatterData(const std::vector<T>& data) {
-    #pragma omp parallel for
-    for (int i = 0; i < localSize; i++) {
-        localVector[i] = data[i + firstIndex];
-    };
+    T* local = localData;
+
+    if (distribution.isContiguous()) {
+        const T* source = data.data() + firstIndex;
+
+        #pragma omp parallel for schedule(static)
+        for (GlobalIndex i = 0; i < localSize; i++) {
+            local[i] = source[i];
+        }
+    } else {
+        #pragma omp parallel for schedule(static)
+        for (GlobalIndex i = 0; i < localSize; i++) {
+            local[i] = data[distribution.globalIndex(rank, i)];
+        }
+    }
+}
+
+template <typename T>
+void VectorDistribution<T>::scatterData(const std::vector<T>& data, int root) {
+    ProfileScope scope("scatter", PROFILE_CALL);
+    if (distribution.isContiguous()) {
+        scatterBlocks(data.data(), root);
+        return;
+    }
+
+    // bring the elements into block order on the root first
+    std::vector<T> blocks(rank == root ? vectorSize : 0);
+    if (rank == root) {
+        for (int p = 0; p < numProcesses; p++) {
+            const GlobalIndex offset = distribution.offsetOf(p);
+
+            #pragma omp parallel for schedule(static)
+            for (GlobalIndex i = 0; i < distribution.localSizeOf(p); i++) {
+                blocks[offset + i] = data[distribution.globalIndex(p, i)];
+            }
+        }
+    }
+    scatterBlocks(blocks.data(), root);
+}
+
+template <typename T>
+void VectorDistribution<T>::scatterBlocks(const T* buffer, int root) {
+    ProfileScope communication("scatter", PROFILE_COMMUNICATION);
+    communication.addBytes(rank == root ? (vectorSize - localSize) * (long long)sizeof(T) : 0,
+                           rank == root ? 0 : localSize * (long long)sizeof(T));
+
+    // counts and displacements of the MPI collectives are limited to 2^31 - 1 elements
+    if (vectorSize > INT_MAX) {
+        scatterLargeData(buffer, root);
+        return;
+    }
+
+    MPI_Scatterv(buffer, blockCounts.data(), blockDisplacements.data(), MpiDatatype<T>::get(),
+                 localData, (int)localSize, MpiDatatype<T>::get(),
+                 root, communicator.get());
+}
+
+template <typename T>
+void VectorDistribution<T>::scatterLargeData(const T* buffer, int root) {
+#if MPI_VERSION >= 4
+    std::vector<MPI_Count> sendCounts(numProcesses);
+    std::vector<MPI_Aint> displacements(numProcesses);
+
+    for (int i = 0; i < numProcesses; i++) {
+        sendCounts[i] = distribution.localSizeOf(i);
+        displacements[i] = distribution.offsetOf(i);
+    }
+
+    MPI_Scatterv_c(buffer, sendCounts.data(), displacements.data(), MpiDatatype<T>::get(),
+                   localData, localSize, MpiDatatype<T>::get(),
+                   root, communicator.get());
+#else
+    // without large-count collectives every block is described by a single derived datatype
+    if (rank == root) {
+        std::vector<MPI_Request> requests;
+
+        for (int i = 0; i < numProcesses; i++) {
+            if (i == root)
+                continue;
+            MPI_Datatype block = createLargeDatatype<T>(distribution.localSizeOf(i));
+            requests.emplace_back();
+            MPI_Isend(buffer + distribution.offsetOf(i), 1, block, i, 0, communicator.get(), &requests.back());
+            MPI_Type_free(&block);
+        }
+        std::copy(buffer + distribution.offsetOf(rank), buffer + distribution.offsetOf(rank) + localSize,
+                  localData);
+        MPI_Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    } else {
+        MPI_Datatype block = createLargeDatatype<T>(localSize);
+        MPI_Recv(localData, 1, block, root, 0, communicator.get(), MPI_STATUS_IGNORE);
+        MPI_Type_free(&block);
+    }
+#endif
 }
 
 template <typename T>
 void VectorDistribution<T>::gatherVectors(std::vector<T>& results) {
-    // if remainingSize != 0
-    if (remainingSize)
-        gatherUnequalVectors(results);
-    else
-        gatherEqualVectors(results);
+    ProfileScope scope("gather", PROFILE_CALL);
+    if (distribution.isContiguous()) {
+        gatherBlocks(results.data());
+        return;
+    }
+
+    // gather in block order and restore the global order on the root
+    std::vector<T> blocks(rank == 0 ? vectorSize : 0);
+    gatherBlocks(blocks.data());
+
+    if (rank == 0)
+        restoreGlobalOrder(distribution, blocks.data(), results.data());
 }
 
+template <typename T>
+void VectorDistribution<T>::readFile(const std::string& path, FileAccess access) {
+    static_assert(std::is_trivially_copyable<T>::value, "readFile: elements have to be trivially copyable");
+
+    ProfileScope scope("readFile", PROFILE_CALL);
+    const VectorFileHeader header = readVectorFileHeader(path, sizeof(T), communicator);
+
+    // keep the layout if the size fits, otherwise distribute the file in balanced blocks
+    if (numProcesses == 0 || header.size != vectorSize) {
+        distribution = Distribution::balancedBlock(header.size, communicator.getSize());
+        init();
+    }
+    if (!distribution.isContiguous())
+        throw std::invalid_argument("readFile: distribution has to be contiguous");
+
+    const MPI_Offset offset = header.dataOffset + firstIndex * (MPI_Offset)sizeof(T);
+
+    if (access == MAPPED_IO) {
+        requireMappedAccess("readFile");
+        MappedFile map(path, offset, localSize * sizeof(T), false);
+        requireAll(map.isValid(), "readFile: cannot map " + path, communicator);
+
+        // every thread copies the chunk it touches in the skeleton loops
+        const char* source = static_cast<const char*>(map.getData());
+        char* local = reinterpret_cast<char*>(localData);
+
+        #pragma omp parallel
+        {
+            GlobalIndex begin, end;
+            staticRange(localSize, omp_get_thread_num(), omp_get_num_threads(), begin, end);
+            std::memcpy(local + begin * sizeof(T), source + begin * sizeof(T), (end - begin) * sizeof(T));
+        }
+        return;
+    }
+
+    // MPI-IO writes the block from the calling thread, place the pages like the skeleton loops first
+    firstTouch();
+
+    MPI_File file = openVectorFile(path, MPI_MODE_RDONLY, communicator);
+    {
+        ProfileScope communication("readFile", PROFILE_COMMUNICATION);
+        communication.addBytes(0, localSize * (long long)sizeof(T));
+        transferFileBlock(file, offset, false);
+    }
+    MPI_File_close(&file);
+}
 
 template <typename T>
-void VectorDistribution<T>::gatherEqualVectors(std::vector<T>& results) {
-    size_t s = localSize * sizeof(T);
-    // Store data from localVectors into results
-    MPI_Gather(localVector.data(), s, MPI_BYTE,
-               results.data(), s, MPI_BYTE,
-               0, MPI_COMM_WORLD);
+void VectorDistribution<T>::writeFile(const std::string& path, FileAccess access) const {
+    static_assert(std::is_trivially_copyable<T>::value, "writeFile: elements have to be trivially copyable");
+
+    if (!distribution.isContiguous())
+        throw std::invalid_argument("writeFile: distribution has to be contiguous");
+
+    ProfileScope scope("writeFile", PROFILE_CALL);
+    const VectorFileHeader header = makeVectorFileHeader(vectorSize, sizeof(T));
+    const MPI_Offset offset = header.dataOffset + firstIndex * (MPI_Offset)sizeof(T);
+
+    if (access == MAPPED_IO) {
+        requireMappedAccess("writeFile");
+        // the root creates the file in its final size, then every process fills its block
+        const bool created = rank != 0 || createVectorFile(path, header);
+        requireAll(created, "writeFile: cannot create " + path, communicator);
+
+        MappedFile map(path, offset, localSize * sizeof(T), true);
+        requireAll(map.isValid(), "writeFile: cannot map " + path, communicator);
+
+        char* target = static_cast<char*>(map.getData());
+        const char* local = reinterpret_cast<const char*>(localData);
+
+        #pragma omp parallel
+        {
+            GlobalIndex begin, end;
+            staticRange(localSize, omp_get_thread_num(), omp_get_num_threads(), begin, end);
+            std::memcpy(target + begin * sizeof(T), local + begin * sizeof(T), (end - begin) * sizeof(T));
+        }
+        requireAll(map.sync(), "writeFile: cannot write " + path, communicator);
+        return;
+    }
+
+    MPI_File file = openVectorFile(path, MPI_MODE_CREATE | MPI_MODE_WRONLY, communicator);
+    {
+        ProfileScope communication("writeFile", PROFILE_COMMUNICATION);
+        communication.addBytes(localSize * (long long)sizeof(T), 0);
+
+        // cut off the rest of a longer file which is replaced
+        MPI_File_set_size(file, header.dataOffset + vectorSize * (MPI_Offset)sizeof(T));
+        if (rank == 0)
+            MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+        transferFileBlock(file, offset, true);
+    }
+    MPI_File_close(&file);
 }
 
 template <typename T>
-void VectorDistribution<T>::gatherUnequalVectors(std::vector<T>& results) {
-    // Gather the sizes of local vectors from all processes
-    int* recvCounts = new int[numProcesses];
-    int elemSize = sizeof(T);
-    const size_t s = localSize * elemSize;
+void VectorDistribution<T>::transferFileBlock(MPI_File file, MPI_Offset offset, bool write) const {
+    // counts of MPI-IO are limited to 2^31 - 1 elements as well
+    MPI_Datatype type = MpiDatatype<T>::get();
+    int count = (int)localSize;
+    const bool large = localSize > INT_MAX;
+    if (large) {
+        type = createLargeDatatype<T>(localSize);
+        count = 1;
+    }
+
+    if (write)
+        MPI_File_write_at_all(file, offset, localData, count, type, MPI_STATUS_IGNORE);
+    else
+        MPI_File_read_at_all(file, offset, localData, count, type, MPI_STATUS_IGNORE);
 
-    // Gather local sizes of each process
-    MPI_Gather(&s, 1, MPI_INT,
-               recvCounts, 1, MPI_INT,
-               0,MPI_COMM_WORLD);
+    if (large)
+        MPI_Type_free(&type);
+}
 
-    int totalCount = 0;
-    int* displacements = new int[numProcesses];
+template <typename T>
+void VectorDistribution<T>::requireMappedAccess(const char* skeleton) const {
+    // all processes see the same page cache only on one node
+    if (communicator.getTopology().node.getSize() != numProcesses)
+        throw std::invalid_argument(std::string(skeleton) + ": MAPPED_IO needs all processes on one node");
+}
 
-    if (rank == 0) {
-        displacements[0] = 0;
-        totalCount += recvCounts[0];
+template <typename T>
+void VectorDistribution<T>::restoreGlobalOrder(const Distribution& layout, const T* blocks, T* results) {
+    for (int p = 0; p < layout.getNumProcesses(); p++) {
+        const GlobalIndex offset = layout.offsetOf(p);
 
-        for (int i = 1; i < numProcesses; i++) {
-            totalCount += recvCounts[i];
-            // Calculate offset to write to correct position in recvBuffer
-            displacements[i] = displacements[i-1] + recvCounts[i-1];
+        #pragma omp parallel for schedule(static)
+        for (GlobalIndex i = 0; i < layout.localSizeOf(p); i++) {
+            results[layout.globalIndex(p, i)] = blocks[offset + i];
         }
     }
+}
 
-    // Actually gather local data to the root process using recvCounts and displacements
-    MPI_Gatherv(localVector.data(), localSize * elemSize, MPI_BYTE,
-                results.data(), recvCounts, displacements, MPI_BYTE,
-                0, MPI_COMM_WORLD);
+template <typename T>
+SkeletonRequest VectorDistribution<T>::gatherAsync(std::vector<T>& results) const {
+    return gatherVectorsAsync(results, false);
+}
 
-    delete[] recvCounts;
-    delete[] displacements;
+template <typename T>
+SkeletonRequest VectorDistribution<T>::allGatherAsync(std::vector<T>& results) const {
+    return gatherVectorsAsync(results, true);
 }
 
 template <typename T>
-void VectorDistribution<T>::printLocal() {
+SkeletonRequest VectorDistribution<T>::gatherVectorsAsync(std::vector<T>& results, bool all) const {
+    // large counts and the staging buffer are read by MPI until the request completes
+    struct State {
+#if MPI_VERSION >= 4
+        std::vector<MPI_Count> counts;
+        std::vector<MPI_Aint> displacements;
+#endif
+        std::vector<T> blocks;
+    };
+    std::shared_ptr<State> state = std::make_shared<State>();
+    SkeletonRequest request;
+    const bool receives = all || rank == 0;
+
+    // non-contiguous distributions are gathered in block order and reordered on completion
+    T* buffer = results.data();
+    if (!distribution.isContiguous()) {
+        state->blocks.resize(receives ? vectorSize : 0);
+        buffer = state->blocks.data();
+
+        if (receives) {
+            const Distribution layout = distribution;
+            std::shared_ptr<State> blocks = state;
+            T* out = results.data();
+            request.onComplete([layout, blocks, out]() {
+                restoreGlobalOrder(layout, blocks->blocks.data(), out);
+            });
+        }
+    }
+
+#if MPI_VERSION >= 4
+    state->counts.resize(numProcesses);
+    state->displacements.resize(numProcesses);
     for (int i = 0; i < numProcesses; i++) {
-        if (rank == i) {
-            std::cout << "Local Vector (Rank " << rank <<"): [ ";
-            for (int j = 0; j < localSize; j++) {
-                std::cout << localVector[j] << " ";
+        state->counts[i] = distribution.localSizeOf(i);
+        state->displacements[i] = distribution.offsetOf(i);
+    }
+
+    if (all)
+        MPI_Iallgatherv_c(localData, localSize, MpiDatatype<T>::get(),
+                          buffer, state->counts.data(), state->displacements.data(), MpiDatatype<T>::get(),
+                          communicator.get(), request.addRequest());
+    else
+        MPI_Igatherv_c(localData, localSize, MpiDatatype<T>::get(),
+                       buffer, state->counts.data(), state->displacements.data(), MpiDatatype<T>::get(),
+                       0, communicator.get(), request.addRequest());
+#else
+    if (vectorSize <= INT_MAX) {
+        if (all)
+            MPI_Iallgatherv(localData, (int)localSize, MpiDatatype<T>::get(),
+                            buffer, blockCounts.data(), blockDisplacements.data(), MpiDatatype<T>::get(),
+                            communicator.get(), request.addRequest());
+        else
+            MPI_Igatherv(localData, (int)localSize, MpiDatatype<T>::get(),
+                         buffer, blockCounts.data(), blockDisplacements.data(), MpiDatatype<T>::get(),
+                         0, communicator.get(), request.addRequest());
+    } else {
+        // without large-count collectives every block is sent as a single derived datatype;
+        // freeing a datatype only marks it, pending operations keep using it
+        MPI_Datatype localBlock = createLargeDatatype<T>(localSize);
+        for (int i = 0; i < numProcesses; i++) {
+            if (i != rank && (all || i == 0))
+                MPI_Isend(localData, 1, localBlock, i, 0, communicator.get(), request.addRequest());
+        }
+        MPI_Type_free(&localBlock);
+
+        if (receives) {
+            for (int i = 0; i < numProcesses; i++) {
+                if (i == rank)
+                    continue;
+                MPI_Datatype block = createLargeDatatype<T>(distribution.localSizeOf(i));
+                MPI_Irecv(buffer + distribution.offsetOf(i), 1, block, i, 0, communicator.get(), request.addRequest());
+                MPI_Type_free(&block);
             }
-            std::cout << "]" << std::endl;
+            std::copy(localData, localData + localSize, buffer + distribution.offsetOf(rank));
         }
-        MPI_Barrier(MPI_COMM_WORLD);
     }
+#endif
+
+    request.keepAlive(state);
+    return request;
 }
 
-template<typename T>
-void VectorDistribution<T>::show(const std::string &descr) {
-    std::vector<T> out(vectorSize);
-    std::ostringstream s;
+template <typename T>
+void VectorDistribution<T>::gatherBlocks(T* buffer) {
+    ProfileScope communication("gather", PROFILE_COMMUNICATION);
+    communication.addBytes(rank == 0 ? 0 : localSize * (long long)sizeof(T),
+                           rank == 0 ? (vectorSize - localSize) * (long long)sizeof(T) : 0);
+
+    // with a shared window only the node leaders communicate
+    if (window && vectorSize <= INT_MAX && communicator.getTopology().consecutive) {
+        gatherNodeBlocks(buffer);
+        return;
+    }
+
+    // counts and displacements of the MPI collectives are limited to 2^31 - 1 elements
+    if (vectorSize > INT_MAX)
+        gatherLargeVectors(buffer);
+    else if (distribution.isUniform())
+        gatherEqualVectors(buffer);
+    else
+        gatherUnequalVectors(buffer);
+}
 
-    if (descr.size() > 0)
-        s << descr << std::endl;
 
-    gatherVectors(out);
+template <typename T>
+void VectorDistribution<T>::gatherNodeBlocks(T* buffer) {
+    const NodeTopology& topology = communicator.getTopology();
 
-    if (rank == 0) {
-        s << "[ ";
-        for (int i = 0; i < vectorSize; i++) {
-            s << out[i];
-            s << " ";
+    // make the blocks of the node visible to its leader
+    window->sync();
+
+    if (topology.isLeader()) {
+        const int first = topology.nodeRanks.front();
+        const int last = topology.nodeRanks.back();
+        const GlobalIndex nodeOffset = distribution.offsetOf(first);
+        const GlobalIndex nodeSize = distribution.offsetOf(last) + distribution.localSizeOf(last) - nodeOffset;
+
+        // the blocks of the node are in block order already if their segments follow each other
+        const T* nodeData = nullptr;
+        std::vector<T> staging;
+        if (window->isContiguous()) {
+            for (int i = 0; i < (int)topology.nodeRanks.size() && nodeData == nullptr; i++) {
+                if (window->getSegmentSize(i) > 0)
+                    nodeData = static_cast<const T*>(window->getSegment(i));
+            }
+        } else {
+            staging.resize(nodeSize);
+            for (int i = 0; i < (int)topology.nodeRanks.size(); i++) {
+                const T* block = static_cast<const T*>(window->getSegment(i));
+                std::copy(block, block + distribution.localSizeOf(topology.nodeRanks[i]),
+                          staging.data() + distribution.offsetOf(topology.nodeRanks[i]) - nodeOffset);
+            }
+            nodeData = staging.data();
         }
-        s << "]" << std::endl;
-        s << std::endl;
 
-        std::cout << s.str().c_str();
+        // the leaders are ordered by rank and every node holds consecutive ranks,
+        // so the block of a node ends where the block of the next leader starts
+        const Communicator& leaders = topology.leaders;
+        const int numLeaders = leaders.getSize();
+        std::vector<int> leaderRanks(numLeaders);
+        MPI_Gather(&first, 1, MPI_INT, leaderRanks.data(), 1, MPI_INT, 0, leaders.get());
+
+        std::vector<int> counts(numLeaders), displacements(numLeaders);
+        for (int i = 0; i < numLeaders; i++) {
+            const GlobalIndex end = i + 1 < numLeaders ? distribution.offsetOf(leaderRanks[i + 1]) : vectorSize;
+            displacements[i] = (int)distribution.offsetOf(leaderRanks[i]);
+            counts[i] = (int)(end - displacements[i]);
+        }
+
+        MPI_Gatherv(nodeData, (int)nodeSize, MpiDatatype<T>::get(),
+                    buffer, counts.data(), displacements.data(), MpiDatatype<T>::get(),
+                    0, leaders.get());
     }
 
-    out.clear();
+    // the owners may only change their blocks after the leader has sent them
+    window->sync();
 }
 
 template <typename T>
-template <typename R, typename MapFunctor>
-VectorDistribution<R> VectorDistribution<T>::map(MapFunctor &f) {
-    VectorDistribution<R> result(vectorSize);
+const T* VectorDistribution<T>::getNodeLocalData(int process) const {
+    if (!window)
+        return nullptr;
 
-    // using omp to share among threads
-    #pragma omp parallel for
-    for (int i = 0; i < localSize; i++) {
-        result.setLocal(i, f(localVector[i]));
+    const std::vector<int>& nodeRanks = communicator.getTopology().nodeRanks;
+    for (int i = 0; i < (int)nodeRanks.size(); i++) {
+        if (nodeRanks[i] == process)
+            return static_cast<const T*>(window->getSegment(i));
     }
-    return result;
+    return nullptr;
 }
 
 template <typename T>
-template <typename ReduceFunctor>
-T VectorDistribution<T>::reduce(ReduceFunctor &f) {
-    T result = T();         // end result
-    T localResult = T();    // localResult for each process
+void VectorDistribution<T>::synchronizeNode() const {
+    if (window)
+        window->sync();
+}
 
-    // multiple threads enter parallel region
-    #pragma omp parallel
-    {
-        // private result for each thread
-        T privateLocalResult = T();
-        auto privateSize = localVector.size();
+template <typename T>
+void VectorDistribution<T>::gatherEqualVectors(T* buffer) {
+    // Store data from localVectors into buffer
+    MPI_Gather(localData, (int)localSize, MpiDatatype<T>::get(),
+               buffer, (int)localSize, MpiDatatype<T>::get(),
+               0, communicator.get());
+}
 
-        // Each thread calculates its portion
-        #pragma omp for
-        for (int i = 0; i < localSize; i++) {
-            privateLocalResult = f(privateLocalResult, localVector[i]);
-        }
+template <typename T>
+void VectorDistribution<T>::gatherUnequalVectors(T* buffer) {
+    // Actually gather local data to the root process using the cached counts and displacements
+    MPI_Gatherv(localData, (int)localSize, MpiDatatype<T>::get(),
+                buffer, blockCounts.data(), blockDisplacements.data(), MpiDatatype<T>::get(),
+                0, communicator.get());
+}
 
-        // Make sure local result is calculated correctly
-        #pragma omp critical
-        {
-            localResult = f(localResult, privateLocalResult);
-        }
+template <typename T>
+void VectorDistribution<T>::gatherLargeVectors(T* buffer) {
+#if MPI_VERSION >= 4
+    std::vector<MPI_Count> recvCounts(numProcesses);
+    std::vector<MPI_Aint> displacements(numProcesses);
+
+    for (int i = 0; i < numProcesses; i++) {
+        recvCounts[i] = distribution.localSizeOf(i);
+        displacements[i] = distribution.offsetOf(i);
     }
 
-    // Gather local results to the root process
-    T* allResults = new T[numProcesses];
+    MPI_Gatherv_c(localData, localSize, MpiDatatype<T>::get(),
+                  buffer, recvCounts.data(), displacements.data(), MpiDatatype<T>::get(),
+                  0, communicator.get());
+#else
+    // without large-count collectives every block is described by a single derived datatype
+    if (rank == 0) {
+        std::vector<MPI_Request> requests(numProcesses - 1);
 
-    size_t s = sizeof(T);
-    MPI_Gather(&localResult, s, MPI_BYTE,
-               allResults, s,MPI_BYTE,
-               0, MPI_COMM_WORLD);
+        for (int i = 1; i < numProcesses; i++) {
+            MPI_Datatype block = createLargeDatatype<T>(distribution.localSizeOf(i));
+            MPI_Irecv(buffer + distribution.offsetOf(i), 1, block, i, 0, communicator.get(), &requests[i - 1]);
+            MPI_Type_free(&block);
+        }
+        std::copy(localData, localData + localSize, buffer);
+        MPI_Waitall(numProcesses - 1, requests.data(), MPI_STATUSES_IGNORE);
+    } else {
+        MPI_Datatype block = createLargeDatatype<T>(localSize);
+        MPI_Send(localData, 1, block, 0, 0, communicator.get());
+        MPI_Type_free(&block);
+    }
+#endif
+}
 
-    // Calculate the end result from partial results in allResults
+template <typename T>
+void VectorDistribution<T>::printLocal() {
     for (int i = 0; i < numProcesses; i++) {
-        result = f(result, allResults[i]);
+        if (rank == i) {
+            std::cout << "Local Vector (Rank " << rank <<"): [ ";
+            for (GlobalIndex j = 0; j < localSize; j++) {
+                std::cout << localData[j] << " ";
+            }
+            std::cout << "]" << std::endl;
+        }
+        MPI_Barrier(communicator.get());
     }
-    delete[] allResults;
+}
 
-    return result;
+template<typename T>
+void VectorDistribution<T>::show(const std::string &descr) {
+    std::ostream& s = std::cout;
+
+    if (rank == 0) {
+        if (descr.size() > 0)
+            s << descr << std::endl;
+        s << "[ ";
+    }
+
+    auto print = [&s] (GlobalIndex, const T* data, GlobalIndex count) {
+        for (GlobalIndex i = 0; i < count; i++) {
+            s << data[i];
+            s << " ";
+        }
+    };
+    gatherStream(print);
+
+    if (rank == 0) {
+        s << "]" << std::endl;
+        s << std::endl;
+    }
 }
 
 template <typename T>
-template <typename R, typename T2, typename ZipFunctor>
-VectorDistribution<R> VectorDistribution<T>::zip(VectorDistribution<T2> &b, ZipFunctor &f) {
-    VectorDistribution<R> result(vectorSize);
+template <typename Sink>
+void VectorDistribution<T>::gatherStream(Sink&& sink, GlobalIndex chunkSize) const {
+    if (chunkSize < 1 || chunkSize > INT_MAX)
+        throw std::invalid_argument("gatherStream: chunk size has to be between 1 and INT_MAX");
 
-    #pragma omp parallel for
-    for (int i = 0; i < localSize; i++) {
-        result.setLocal(i, f(localVector[i], b.getLocal(i)));
+    ProfileScope scope("gatherStream", PROFILE_CALL);
+    // the private duplicate keeps the chunks apart from messages of the application
+    const MPI_Comm streamComm = communicator.getPrivate();
+    const int streamTag = 3;
+
+    if (rank != 0) {
+        ProfileScope communication("gatherStream", PROFILE_COMMUNICATION);
+        communication.addBytes(localSize * (long long)sizeof(T), 0);
+
+        // a synchronous send completes only after the root has posted its receive, so the root never
+        // has to buffer more chunks than it asked for
+        for (GlobalIndex begin = 0; begin < localSize; begin += chunkSize) {
+            const int count = (int)std::min(chunkSize, localSize - begin);
+            MPI_Ssend(localData + begin, count, MpiDatatype<T>::get(), 0, streamTag, streamComm);
+        }
+        return;
+    }
+
+    // two chunk buffers per sending process, chunk c of a process lives in slot c % 2
+    struct Stream {
+        std::vector<T> buffers[2];
+        MPI_Request requests[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+        GlobalIndex posted = 0;
+        GlobalIndex consumed = 0;
+    };
+    std::vector<Stream> streams(numProcesses);
+
+    auto post = [&] (int p) {
+        Stream& stream = streams[p];
+        const GlobalIndex size = distribution.localSizeOf(p);
+        const GlobalIndex chunks = (size + chunkSize - 1) / chunkSize;
+        while (stream.posted < chunks && stream.posted < stream.consumed + 2) {
+            const int slot = (int)(stream.posted % 2);
+            const GlobalIndex begin = stream.posted * chunkSize;
+            const int count = (int)std::min(chunkSize, size - begin);
+            stream.buffers[slot].resize(count);
+            MPI_Irecv(stream.buffers[slot].data(), count, MpiDatatype<T>::get(), p, streamTag, streamComm,
+                      &stream.requests[slot]);
+            stream.posted++;
+        }
+    };
+
+    GlobalIndex g = 0;
+    while (g < vectorSize) {
+        const int p = distribution.ownerOf(g);
+        GlobalIndex local = distribution.localIndexOf(g);
+        GlobalIndex run = distribution.runLength(g);
+
+        // the owner of the next run already sends while this one is consumed
+        if (g + run < vectorSize && distribution.ownerOf(g + run) != 0)
+            post(distribution.ownerOf(g + run));
+
+        if (p == 0) {
+            while (run > 0) {
+                const GlobalIndex count = std::min(chunkSize, run);
+                sink(g, localData + local, count);
+                g += count;
+                local += count;
+                run -= count;
+            }
+            continue;
+        }
+
+        Stream& stream = streams[p];
+        const GlobalIndex size = distribution.localSizeOf(p);
+        post(p);
+        while (run > 0) {
+            const GlobalIndex chunk = local / chunkSize;
+            const int slot = (int)(chunk % 2);
+            {
+                ProfileScope communication("gatherStream", PROFILE_COMMUNICATION);
+                MPI_Wait(&stream.requests[slot], MPI_STATUS_IGNORE);
+            }
+
+            const GlobalIndex offset = local - chunk * chunkSize;
+            const GlobalIndex count = std::min(run, (GlobalIndex)stream.buffers[slot].size() - offset);
+            sink(g, stream.buffers[slot].data() + offset, count);
+            g += count;
+            local += count;
+            run -= count;
+
+            // the slot of a finished chunk receives the chunk after the next one
+            if (local == (chunk + 1) * chunkSize || local == size) {
+                stream.consumed = chunk + 1;
+                post(p);
+            }
+        }
+
+        if (local == size) {
+            std::vector<T>().swap(stream.buffers[0]);
+            std::vector<T>().swap(stream.buffers[1]);
+        }
+    }
+}
+
+template <typename T>
+template <typename R, typename MapFunctor>
+MapExpression<R, DistributionTerminal<T>, MapFunctor> VectorDistribution<T>::map(MapFunctor &f) const {
+    return MapExpression<R, DistributionTerminal<T>, MapFunctor>(DistributionTerminal<T>(*this), f);
+}
+
+template <typename T>
+template <typename R, typename MapFunctor>
+void VectorDistribution<T>::map(MapFunctor &f, VectorDistribution<R>& out) const {
+    out = map<R>(f);
+}
+
+template <typename T>
+template <typename MapFunctor>
+void VectorDistribution<T>::mapInPlace(MapFunctor &f) {
+    static_assert(IsMapFunctor<MapFunctor, T, T>::value, "mapInPlace: functor has to be callable as T f(T) const");
+
+    ProfileScope scope("mapInPlace", PROFILE_CALL);
+    ThreadTimer timer;
+    T* local = localData;
+
+    #pragma omp parallel
+    {
+        timer.start();
+        #pragma omp for schedule(static) nowait
+        for (GlobalIndex i = 0; i < localSize; i++) {
+            local[i] = f(local[i]);
+        }
+        timer.stop();
+    }
+}
+
+template <typename T>
+template <typename R, typename MapFunctor>
+MapIndexExpression<R, DistributionTerminal<T>, MapFunctor> VectorDistribution<T>::mapIndex(MapFunctor &f) const {
+    return MapIndexExpression<R, DistributionTerminal<T>, MapFunctor>(DistributionTerminal<T>(*this), f);
+}
+
+template <typename T>
+template <typename R, typename MapFunctor>
+void VectorDistribution<T>::mapIndex(MapFunctor &f, VectorDistribution<R>& out) const {
+    out = mapIndex<R>(f);
+}
+
+template <typename T>
+template <typename MapFunctor>
+void VectorDistribution<T>::mapIndexInPlace(MapFunctor &f) {
+    static_assert(IsMapIndexFunctor<MapFunctor, T, T>::value,
+                  "mapIndexInPlace: functor has to be callable as T f(GlobalIndex, T) const");
+
+    ProfileScope scope("mapIndexInPlace", PROFILE_CALL);
+    T* local = localData;
+
+    if (distribution.isContiguous()) {
+        GlobalIndex first = firstIndex;
+
+        #pragma omp parallel for schedule(static)
+        for (GlobalIndex i = 0; i < localSize; i++) {
+            local[i] = f(first + i, local[i]);
+        }
+    } else {
+        #pragma omp parallel for schedule(static)
+        for (GlobalIndex i = 0; i < localSize; i++) {
+            local[i] = f(distribution.globalIndex(rank, i), local[i]);
+        }
+    }
+}
+
+template <typename T>
+template <typename R, typename StencilFunctor>
+void VectorDistribution<T>::mapStencil(GlobalIndex radius, StencilFunctor& f, VectorDistribution<R>& out,
+                                       BoundaryMode mode, const T& boundary) const {
+    static_assert(IsStencilFunctor<StencilFunctor, T, R>::value,
+                  "mapStencil: functor has to be callable as R f(const Neighborhood<T>&) const");
+
+    if (static_cast<const void*>(&out) == static_cast<const void*>(this))
+        throw std::invalid_argument("mapStencil: output has to be another distribution");
+    if (radius < 0)
+        throw std::invalid_argument("mapStencil: radius must not be negative");
+    if (!distribution.isContiguous())
+        throw std::invalid_argument("mapStencil: distribution has to be contiguous");
+    for (int p = 0; p < numProcesses; p++) {
+        if (distribution.localSizeOf(p) < radius)
+            throw std::invalid_argument("mapStencil: every process has to hold at least radius elements");
+    }
+
+    if (out.getDistribution() != distribution || out.getCommunicator() != communicator)
+        out = VectorDistribution<R>(distribution, communicator);
+
+    ProfileScope scope("mapStencil", PROFILE_CALL);
+    const GlobalIndex n = localSize;
+    const GlobalIndex r = radius;
+    const T* local = localData;
+    R* result = out.getLocalData();
+
+    // blocks of at least 2r elements get two edge buffers [left halo | first 2r] and [last 2r | right halo],
+    // smaller blocks a single buffer [left halo | block | right halo]
+    const bool small = n < 2 * r;
+    stencilBuffer.resize(small ? n + 2 * r : 6 * r);
+    T* leftEdge = stencilBuffer.data();
+    T* rightEdge = small ? leftEdge : leftEdge + 3 * r;
+    T* leftHalo = leftEdge;
+    T* rightHalo = small ? leftEdge + r + n : rightEdge + 2 * r;
+
+    const bool periodic = mode == PERIODIC;
+    const int left = rank > 0 ? rank - 1 : (periodic ? numProcesses - 1 : MPI_PROC_NULL);
+    const int right = rank < numProcesses - 1 ? rank + 1 : (periodic ? 0 : MPI_PROC_NULL);
+    // distinct tags, with two processes both neighbors are the same process
+    const int toLeft = 1, toRight = 2;
+
+    MPI_Request requests[4];
+    int numRequests = 0;
+    if (r > 0) {
+        ProfileScope communication("mapStencil", PROFILE_COMMUNICATION);
+        const long long haloBytes = r * (long long)sizeof(T) * ((left != MPI_PROC_NULL) + (right != MPI_PROC_NULL));
+        communication.addBytes(haloBytes, haloBytes);
+        // on the private duplicate, the tags must not meet messages of the application
+        const MPI_Comm halo = communicator.getPrivate();
+        MPI_Irecv(leftHalo, (int)r, MpiDatatype<T>::get(), left, toRight, halo, &requests[numRequests++]);
+        MPI_Irecv(rightHalo, (int)r, MpiDatatype<T>::get(), right, toLeft, halo, &requests[numRequests++]);
+        MPI_Isend(local, (int)r, MpiDatatype<T>::get(), left, toLeft, halo, &requests[numRequests++]);
+        MPI_Isend(local + n - r, (int)r, MpiDatatype<T>::get(), right, toRight, halo, &requests[numRequests++]);
+
+        // without a neighbor the halo comes from the boundary mode
+        if (left == MPI_PROC_NULL)
+            std::fill(leftHalo, leftHalo + r, mode == FIXED ? boundary : local[0]);
+        if (right == MPI_PROC_NULL)
+            std::fill(rightHalo, rightHalo + r, mode == FIXED ? boundary : local[n - 1]);
+    }
+
+    // the interior only needs local elements, update it while the halos are in flight
+    #pragma omp parallel for schedule(static)
+    for (GlobalIndex i = r; i < n - r; i++) {
+        result[i] = f(Neighborhood<T>(local + i, r, firstIndex + i));
+    }
+
+    if (small) {
+        std::copy(local, local + n, leftEdge + r);
+    } else {
+        std::copy(local, local + 2 * r, leftEdge + r);
+        std::copy(local + n - 2 * r, local + n, rightEdge);
+    }
+    {
+        ProfileScope communication("mapStencil", PROFILE_COMMUNICATION);
+        MPI_Waitall(numRequests, requests, MPI_STATUSES_IGNORE);
+    }
+
+    // the first and last r elements see the halos
+    const GlobalIndex edges = small ? n : 2 * r;
+
+    #pragma omp parallel for schedule(static)
+    for (GlobalIndex e = 0; e < edges; e++) {
+        const GlobalIndex i = small || e < r ? e : n - 2 * r + e;
+        const T* center = small || e < r ? leftEdge + r + i : rightEdge + e;
+        result[i] = f(Neighborhood<T>(center, r, firstIndex + i));
+    }
+}
+
+template <typename T>
+template <typename R, typename StencilFunctor>
+VectorDistribution<R> VectorDistribution<T>::mapStencil(GlobalIndex radius, StencilFunctor& f,
+                                                        BoundaryMode mode, const T& boundary) const {
+    VectorDistribution<R> out(distribution, communicator);
+    mapStencil(radius, f, out, mode, boundary);
+    return out;
+}
+
+template <typename T>
+template <typename ScanFunctor>
+VectorDistribution<T> VectorDistribution<T>::scan(ScanFunctor &f) const {
+    VectorDistribution<T> out;
+    out.distribution = distribution;
+    out.communicator = communicator;
+    out.init();
+    // the scan writes every element in a schedule(static) loop, which is the first touch
+    scanBlock(f, nullptr, false, out.localData);
+    return out;
+}
+
+template <typename T>
+template <typename ScanFunctor>
+void VectorDistribution<T>::scanInPlace(ScanFunctor &f) {
+    scanBlock(f, nullptr, false, localData);
+}
+
+template <typename T>
+template <typename ScanFunctor>
+VectorDistribution<T> VectorDistribution<T>::exscan(ScanFunctor &f, const T& identity) const {
+    VectorDistribution<T> out;
+    out.distribution = distribution;
+    out.communicator = communicator;
+    out.init();
+    scanBlock(f, &identity, true, out.localData);
+    return out;
+}
+
+template <typename T>
+template <typename ScanFunctor>
+void VectorDistribution<T>::exscanInPlace(ScanFunctor &f, const T& identity) {
+    scanBlock(f, &identity, true, localData);
+}
+
+template <typename T>
+template <typename Comparator>
+VectorDistribution<T> VectorDistribution<T>::sort(Comparator &comp) const {
+    VectorDistribution<T> result(*this);
+    result.sortInPlace(comp);
+    return result;
+}
+
+template <typename T>
+template <typename Comparator>
+void VectorDistribution<T>::sortInPlace(Comparator &comp) {
+    static_assert(IsCompareFunctor<Comparator, T>::value, "sort: functor has to be callable as bool f(T, T) const");
+
+    ProfileScope scope("sort", PROFILE_CALL);
+    std::vector<T, LocalAllocator<T>> sorted(localSize);
+    parallelSort(localData, localSize, sorted.data(), comp);
+
+    if (numProcesses == 1 || vectorSize == 0) {
+        T* local = localData;
+        #pragma omp parallel for schedule(static)
+        for (GlobalIndex i = 0; i < localSize; i++) {
+            local[i] = sorted[i];
+        }
+        return;
+    }
+
+    // bucket p of the sorted block goes to process p
+    const std::vector<T> splitters = selectSplitters(sorted.data(), localSize, vectorSize, comp, communicator);
+    const std::vector<GlobalIndex> bounds = splitPositions(sorted.data(), localSize, splitters, comp);
+
+    // MPI_Alltoallv counts and displacements are int
+    requireAll(localSize <= INT_MAX, "sort: local block of more than INT_MAX elements", communicator);
+    std::vector<int> sendCounts(numProcesses), sendDisplacements(numProcesses);
+    std::vector<int> receiveCounts(numProcesses), receiveDisplacements(numProcesses);
+    for (int p = 0; p < numProcesses; p++) {
+        sendCounts[p] = (int)(bounds[p + 1] - bounds[p]);
+        sendDisplacements[p] = (int)bounds[p];
+    }
+
+    GlobalIndex received = 0;
+    std::vector<T, LocalAllocator<T>> buckets;
+    {
+        ProfileScope communication("sort", PROFILE_COMMUNICATION);
+        MPI_Alltoall(sendCounts.data(), 1, MPI_INT, receiveCounts.data(), 1, MPI_INT, communicator.get());
+        for (int p = 0; p < numProcesses; p++) {
+            receiveDisplacements[p] = (int)received;
+            received += receiveCounts[p];
+        }
+        requireAll(received <= INT_MAX, "sort: more than INT_MAX elements in one bucket", communicator);
+
+        buckets.resize(received);
+        communication.addBytes(localSize * sizeof(T), received * sizeof(T));
+        MPI_Alltoallv(sorted.data(), sendCounts.data(), sendDisplacements.data(), MpiDatatype<T>::get(),
+                      buckets.data(), receiveCounts.data(), receiveDisplacements.data(), MpiDatatype<T>::get(),
+                      communicator.get());
+    }
+
+    // the buckets from all processes are sorted runs
+    std::vector<SortedRun<T>> runs(numProcesses);
+    for (int p = 0; p < numProcesses; p++) {
+        runs[p] = {buckets.data() + receiveDisplacements[p], receiveCounts[p]};
+    }
+    sorted.clear();
+    sorted.resize(received);
+    mergeRuns(runs, sorted.data(), comp);
+
+    if (!distribution.isContiguous())
+        *this = VectorDistribution<T>(Distribution::balancedBlock(vectorSize, numProcesses), communicator);
+
+    // the merged bucket starts behind the buckets of the lower ranks
+    GlobalIndex offset = 0;
+    ProfileScope communication("sort", PROFILE_COMMUNICATION);
+    communication.addBytes(received * sizeof(T), localSize * sizeof(T));
+    MPI_Exscan(&received, &offset, 1, MPI_INT64_T, MPI_SUM, communicator.get());
+    if (rank == 0)
+        offset = 0;
+    redistributeRange(sorted.data(), offset, received, localData, firstIndex, localSize, communicator.get());
+}
+
+template <typename T>
+template <typename Predicate>
+VectorDistribution<T> VectorDistribution<T>::filter(Predicate &f) const {
+    static_assert(IsMapFunctor<Predicate, T, bool>::value, "filter: functor has to be callable as bool f(T) const");
+
+    if (!distribution.isContiguous())
+        throw std::invalid_argument("filter: distribution has to be contiguous");
+
+    ProfileScope scope("filter", PROFILE_CALL);
+    const T* in = localData;
+    std::vector<PaddedValue<GlobalIndex>> offsets(omp_get_max_threads());
+    int numThreads = 1;
+
+    // count the kept elements of every thread's chunk
+    {
+        ThreadTimer timer;
+        #pragma omp parallel
+        {
+            const int thread = omp_get_thread_num();
+            timer.start();
+            if (thread == 0)
+                numThreads = omp_get_num_threads();
+
+            GlobalIndex begin, end, count = 0;
+            staticRange(localSize, thread, omp_get_num_threads(), begin, end);
+            for (GlobalIndex i = begin; i < end; i++) {
+                count += f(in[i]) ? 1 : 0;
+            }
+            offsets[thread].value = count;
+            timer.stop();
+        }
+    }
+
+    // exclusive scan over the threads gives the position of every chunk in the new block
+    GlobalIndex kept = 0;
+    for (int t = 0; t < numThreads; t++) {
+        const GlobalIndex count = offsets[t].value;
+        offsets[t].value = kept;
+        kept += count;
+    }
+
+    std::vector<GlobalIndex> localSizes(numProcesses);
+    {
+        ProfileScope communication("filter", PROFILE_COMMUNICATION);
+        communication.addBytes(sizeof(GlobalIndex), numProcesses * sizeof(GlobalIndex));
+        MPI_Allgather(&kept, 1, MPI_INT64_T, localSizes.data(), 1, MPI_INT64_T, communicator.get());
+    }
+
+    VectorDistribution<T> result;
+    result.distribution = Distribution::irregularBlock(localSizes);
+    result.communicator = communicator;
+    result.init();
+
+    // copying the kept elements is the first touch of the new block
+    T* out = result.localData;
+    ThreadTimer timer;
+    #pragma omp parallel
+    {
+        timer.start();
+        // the same chunks as above, even if the region gets fewer threads
+        #pragma omp for schedule(static) nowait
+        for (int chunk = 0; chunk < numThreads; chunk++) {
+            GlobalIndex begin, end;
+            staticRange(localSize, chunk, numThreads, begin, end);
+            T* next = out + offsets[chunk].value;
+            for (GlobalIndex i = begin; i < end; i++) {
+                if (f(in[i]))
+                    *next++ = in[i];
+            }
+        }
+        timer.stop();
+    }
+    return result;
+}
+
+template <typename T>
+void VectorDistribution<T>::redistribute(const Distribution& target) {
+    if (target.getSize() != vectorSize || target.getNumProcesses() != numProcesses)
+        throw std::invalid_argument("redistribute: layout needs the same size and number of processes");
+    if (!distribution.isContiguous() || !target.isContiguous())
+        throw std::invalid_argument("redistribute: distributions have to be contiguous");
+    if (target == distribution)
+        return;
+
+    ProfileScope scope("redistribute", PROFILE_CALL);
+    VectorDistribution<T> result;
+    result.distribution = target;
+    result.communicator = communicator;
+    result.init();
+
+    // the private duplicate keeps the blocks apart from messages of the application
+    const MPI_Comm redistributeComm = communicator.getPrivate();
+    const int redistributeTag = 4;
+    std::vector<MPI_Request> requests;
+    std::vector<MPI_Datatype> largeTypes;
+    long long bytesSent = 0, bytesReceived = 0;
+
+    // [begin, begin + count) is the overlap of two blocks
+    auto overlap = [] (GlobalIndex aFirst, GlobalIndex aSize, GlobalIndex bFirst, GlobalIndex bSize, GlobalIndex& begin) {
+        begin = std::max(aFirst, bFirst);
+        return std::max<GlobalIndex>(0, std::min(aFirst + aSize, bFirst + bSize) - begin);
+    };
+    // blocks of more than INT_MAX elements are sent as one element of a large datatype
+    auto datatype = [&largeTypes] (GlobalIndex count, int& n) {
+        if (count <= INT_MAX) {
+            n = (int)count;
+            return MpiDatatype<T>::get();
+        }
+        n = 1;
+        largeTypes.push_back(createLargeDatatype<T>(count));
+        return largeTypes.back();
+    };
+
+    {
+        ProfileScope communication("redistribute", PROFILE_COMMUNICATION);
+        for (int p = 0; p < numProcesses; p++) {
+            if (p == rank)
+                continue;
+
+            GlobalIndex begin;
+            int n;
+            // from the old owner of a part of the new block
+            GlobalIndex count = overlap(distribution.firstIndexOf(p), distribution.localSizeOf(p), result.firstIndex,
+                                        result.localSize, begin);
+            if (count > 0) {
+                MPI_Datatype type = datatype(count, n);
+                requests.emplace_back();
+                MPI_Irecv(result.localData + (begin - result.firstIndex), n, type, p, redistributeTag,
+                          redistributeComm, &requests.back());
+                bytesReceived += count * sizeof(T);
+            }
+
+            // to the new owner of a part of the old block
+            count = overlap(firstIndex, localSize, target.firstIndexOf(p), target.localSizeOf(p), begin);
+            if (count > 0) {
+                MPI_Datatype type = datatype(count, n);
+                requests.emplace_back();
+                MPI_Isend(localData + (begin - firstIndex), n, type, p, redistributeTag, redistributeComm,
+                          &requests.back());
+                bytesSent += count * sizeof(T);
+            }
+        }
+        communication.addBytes(bytesSent, bytesReceived);
+    }
+
+    // the part which stays on this process is copied while the messages are in flight
+    GlobalIndex begin;
+    const GlobalIndex kept = overlap(firstIndex, localSize, result.firstIndex, result.localSize, begin);
+    const T* source = localData + (begin - firstIndex);
+    T* dest = result.localData + (begin - result.firstIndex);
+    #pragma omp parallel for schedule(static)
+    for (GlobalIndex i = 0; i < kept; i++) {
+        dest[i] = source[i];
+    }
+
+    {
+        ProfileScope communication("redistribute", PROFILE_COMMUNICATION);
+        MPI_Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    }
+    for (MPI_Datatype& type : largeTypes) {
+        MPI_Type_free(&type);
+    }
+    *this = std::move(result);
+}
+
+template <typename T>
+void VectorDistribution<T>::rebalance() {
+    redistribute(Distribution::balancedBlock(vectorSize, numProcesses));
+}
+
+template <typename T>
+template <typename K, typename V, typename KeyFunctor, typename ValueFunctor, typename ReduceFunctor>
+VectorDistribution<KeyValue<K, V>> VectorDistribution<T>::reduceByKey(KeyFunctor &keyFn, ValueFunctor &valueFn,
+                                                                      ReduceFunctor &combine) const {
+    static_assert(IsMapFunctor<KeyFunctor, T, K>::value, "reduceByKey: key functor has to be callable as K f(T) const");
+    static_assert(IsMapFunctor<ValueFunctor, T, V>::value, "reduceByKey: value functor has to be callable as V f(T) const");
+    static_assert(IsReduceFunctor<ReduceFunctor, V>::value, "reduceByKey: functor has to be callable as V f(V, V) const");
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                  "reduceByKey: keys and values are sent as bytes and have to be trivially copyable");
+
+    ProfileScope scope("reduceByKey", PROFILE_CALL);
+    typedef KeyValue<K, V> Group;
+    const T* in = localData;
+    const int numThreads = omp_get_max_threads();
+
+    // partition j holds the keys with (hash / numProcesses) % numThreads == j; every chunk has its own
+    // table per partition, so the chunks and later the partitions are aggregated without locking
+    auto partitionOf = [this, numThreads] (std::uint64_t hash) {
+        return (int)((hash / (std::uint64_t)numProcesses) % (std::uint64_t)numThreads);
+    };
+    std::vector<KeyTable<K, V>> tables(numThreads * numThreads);
+    std::vector<KeyTable<K, V>> partitions(numThreads);
+    // sendCounts[j * numProcesses + p] is the number of groups of partition j owned by process p
+    std::vector<GlobalIndex> sendCounts(numThreads * numProcesses, 0);
+    {
+        ThreadTimer timer;
+        #pragma omp parallel
+        {
+            timer.start();
+            // chunk t of the block is aggregated into the tables of row t
+            #pragma omp for schedule(static)
+            for (int chunk = 0; chunk < numThreads; chunk++) {
+                GlobalIndex begin, end;
+                staticRange(localSize, chunk, numThreads, begin, end);
+                KeyTable<K, V>* row = &tables[chunk * numThreads];
+                for (GlobalIndex i = begin; i < end; i++) {
+                    const K key = keyFn(in[i]);
+                    insertKey(row[partitionOf(hashKey(key))], key, valueFn(in[i]), combine);
+                }
+            }
+
+            #pragma omp for schedule(static) nowait
+            for (int j = 0; j < numThreads; j++) {
+                KeyTable<K, V>& partition = partitions[j];
+                partition = std::move(tables[j]);
+                for (int t = 1; t < numThreads; t++) {
+                    for (const auto& entry : tables[t * numThreads + j]) {
+                        insertKey(partition, entry.first, entry.second, combine);
+                    }
+                    KeyTable<K, V>().swap(tables[t * numThreads + j]);
+                }
+                for (const auto& entry : partition) {
+                    sendCounts[j * numProcesses + hashKey(entry.first) % numProcesses]++;
+                }
+            }
+            timer.stop();
+        }
+    }
+
+    // the groups for process p are ordered by partition
+    std::vector<int> counts(numProcesses, 0), displacements(numProcesses, 0);
+    std::vector<GlobalIndex> positions(numThreads * numProcesses);
+    GlobalIndex numGroups = 0;
+    for (int p = 0; p < numProcesses; p++) {
+        displacements[p] = (int)std::min<GlobalIndex>(numGroups, INT_MAX);
+        for (int j = 0; j < numThreads; j++) {
+            positions[j * numProcesses + p] = numGroups;
+            numGroups += sendCounts[j * numProcesses + p];
+        }
+        counts[p] = (int)std::min<GlobalIndex>(numGroups - displacements[p], INT_MAX);
+    }
+    requireAll(numGroups <= INT_MAX, "reduceByKey: more than INT_MAX groups on one process", communicator);
+
+    std::vector<Group> sendBuffer(numGroups);
+    #pragma omp parallel for schedule(static)
+    for (int j = 0; j < numThreads; j++) {
+        GlobalIndex* position = &positions[j * numProcesses];
+        for (const auto& entry : partitions[j]) {
+            sendBuffer[position[hashKey(entry.first) % numProcesses]++] = Group{entry.first, entry.second};
+        }
+        KeyTable<K, V>().swap(partitions[j]);
+    }
+
+    std::vector<int> receiveCounts(numProcesses), receiveDisplacements(numProcesses);
+    std::vector<Group> receiveBuffer;
+    {
+        ProfileScope communication("reduceByKey", PROFILE_COMMUNICATION);
+        MPI_Alltoall(counts.data(), 1, MPI_INT, receiveCounts.data(), 1, MPI_INT, communicator.get());
+        GlobalIndex received = 0;
+        for (int p = 0; p < numProcesses; p++) {
+            receiveDisplacements[p] = (int)std::min<GlobalIndex>(received, INT_MAX);
+            received += receiveCounts[p];
+        }
+        requireAll(received <= INT_MAX, "reduceByKey: more than INT_MAX groups received on one process", communicator);
+
+        receiveBuffer.resize(received);
+        communication.addBytes(numGroups * sizeof(Group), received * sizeof(Group));
+        MPI_Alltoallv(sendBuffer.data(), counts.data(), displacements.data(), MpiDatatype<Group>::get(),
+                      receiveBuffer.data(), receiveCounts.data(), receiveDisplacements.data(),
+                      MpiDatatype<Group>::get(), communicator.get());
+    }
+    std::vector<Group>().swap(sendBuffer);
+
+    // the received groups are bucketed by partition with a counting sort, so every partition only
+    // visits its own groups
+    const GlobalIndex received = (GlobalIndex)receiveBuffer.size();
+    std::vector<int> partitionIds(received);
+    std::vector<Group> buckets(received);
+    // bucketPositions[t * numThreads + j] counts the groups of partition j in chunk t of the received
+    // groups, then holds where chunk t writes them
+    std::vector<GlobalIndex> bucketPositions(numThreads * numThreads, 0);
+    // bucket j is [bucketBegins[j], bucketBegins[j + 1])
+    std::vector<GlobalIndex> bucketBegins(numThreads + 1, 0);
+    std::vector<PaddedValue<GlobalIndex>> offsets(numThreads);
+    {
+        ThreadTimer timer;
+        #pragma omp parallel
+        {
+            timer.start();
+            #pragma omp for schedule(static)
+            for (int chunk = 0; chunk < numThreads; chunk++) {
+                GlobalIndex begin, end;
+                staticRange(received, chunk, numThreads, begin, end);
+                GlobalIndex* count = &bucketPositions[chunk * numThreads];
+                for (GlobalIndex i = begin; i < end; i++) {
+                    partitionIds[i] = partitionOf(hashKey(receiveBuffer[i].key));
+                    count[partitionIds[i]]++;
+                }
+            }
+
+            // bucket j holds the groups of partition j in chunk order
+            #pragma omp single
+            {
+                GlobalIndex position = 0;
+                for (int j = 0; j < numThreads; j++) {
+                    bucketBegins[j] = position;
+                    for (int t = 0; t < numThreads; t++) {
+                        const GlobalIndex count = bucketPositions[t * numThreads + j];
+                        bucketPositions[t * numThreads + j] = position;
+                        position += count;
+                    }
+                }
+                bucketBegins[numThreads] = position;
+            }
+
+            #pragma omp for schedule(static)
+            for (int chunk = 0; chunk < numThreads; chunk++) {
+                GlobalIndex begin, end;
+                staticRange(received, chunk, numThreads, begin, end);
+                GlobalIndex* position = &bucketPositions[chunk * numThreads];
+                for (GlobalIndex i = begin; i < end; i++) {
+                    buckets[position[partitionIds[i]]++] = receiveBuffer[i];
+                }
+            }
+            #pragma omp single nowait
+            std::vector<Group>().swap(receiveBuffer);
+
+            #pragma omp for schedule(static) nowait
+            for (int j = 0; j < numThreads; j++) {
+                KeyTable<K, V>& partition = partitions[j];
+                for (GlobalIndex i = bucketBegins[j]; i < bucketBegins[j + 1]; i++) {
+                    insertKey(partition, buckets[i].key, buckets[i].value, combine);
+                }
+                offsets[j].value = (GlobalIndex)partition.size();
+            }
+            timer.stop();
+        }
+    }
+
+    GlobalIndex owned = 0;
+    for (int t = 0; t < numThreads; t++) {
+        const GlobalIndex size = offsets[t].value;
+        offsets[t].value = owned;
+        owned += size;
+    }
+
+    std::vector<GlobalIndex> localSizes(numProcesses);
+    {
+        ProfileScope communication("reduceByKey", PROFILE_COMMUNICATION);
+        MPI_Allgather(&owned, 1, MPI_INT64_T, localSizes.data(), 1, MPI_INT64_T, communicator.get());
+    }
+
+    VectorDistribution<Group> result(Distribution::irregularBlock(localSizes), communicator);
+    Group* out = result.getLocalData();
+    #pragma omp parallel for schedule(static)
+    for (int j = 0; j < numThreads; j++) {
+        Group* next = out + offsets[j].value;
+        for (const auto& entry : partitions[j]) {
+            *next++ = Group{entry.first, entry.second};
+        }
+    }
+    return result;
+}
+
+template <typename T>
+template <typename BinFunctor>
+VectorDistribution<GlobalIndex> VectorDistribution<T>::histogram(BinFunctor &bin, GlobalIndex numBins) const {
+    static_assert(IsMapFunctor<BinFunctor, T, GlobalIndex>::value, "histogram: functor has to be callable as GlobalIndex f(T) const");
+
+    if (numBins < 1)
+        throw std::invalid_argument("histogram: number of bins has to be positive");
+    const Distribution bins = Distribution::balancedBlock(numBins, numProcesses);
+    if (bins.localSizeOf(0) > INT_MAX)
+        throw std::invalid_argument("histogram: more than INT_MAX bins per process");
+
+    ProfileScope scope("histogram", PROFILE_CALL);
+    const T* in = localData;
+    const int numThreads = omp_get_max_threads();
+    // the counters of every chunk start on their own cache line
+    const GlobalIndex perLine = CACHE_LINE_SIZE / sizeof(GlobalIndex);
+    const GlobalIndex stride = (numBins + perLine - 1) / perLine * perLine;
+    std::vector<GlobalIndex, LocalAllocator<GlobalIndex>> counts(numThreads * stride);
+    ThreadTimer timer;
+
+    #pragma omp parallel
+    {
+        timer.start();
+        #pragma omp for schedule(static)
+        for (int chunk = 0; chunk < numThreads; chunk++) {
+            GlobalIndex* own = counts.data() + chunk * stride;
+            std::fill(own, own + numBins, 0);
+
+            GlobalIndex begin, end;
+            staticRange(localSize, chunk, numThreads, begin, end);
+            for (GlobalIndex i = begin; i < end; i++) {
+                const GlobalIndex b = bin(in[i]);
+                if (b >= 0 && b < numBins)
+                    own[b]++;
+            }
+        }
+
+        // sum the counters of all chunks into those of chunk 0
+        #pragma omp for schedule(static) nowait
+        for (GlobalIndex b = 0; b < numBins; b++) {
+            GlobalIndex sum = counts[b];
+            for (int chunk = 1; chunk < numThreads; chunk++) {
+                sum += counts[chunk * stride + b];
+            }
+            counts[b] = sum;
+        }
+        timer.stop();
+    }
+
+    VectorDistribution<GlobalIndex> result(bins, communicator);
+    std::vector<int> receiveCounts(numProcesses);
+    for (int p = 0; p < numProcesses; p++) {
+        receiveCounts[p] = (int)bins.localSizeOf(p);
+    }
+
+    ProfileScope communication("histogram", PROFILE_COMMUNICATION);
+    communication.addBytes(numBins * sizeof(GlobalIndex), result.getLocalSize() * sizeof(GlobalIndex));
+    MPI_Reduce_scatter(counts.data(), result.getLocalData(), receiveCounts.data(), MPI_INT64_T, MPI_SUM,
+                       communicator.get());
+    return result;
+}
+
+template <typename T>
+VectorDistribution<GlobalIndex> VectorDistribution<T>::histogram(const T& min, const T& max, GlobalIndex numBins) const {
+    static_assert(std::is_arithmetic<T>::value, "histogram: bins of equal width need an arithmetic element type");
+
+    if (!(min < max))
+        throw std::invalid_argument("histogram: range has to be non-empty");
+
+    const double scale = (double)numBins / ((double)max - (double)min);
+    auto bin = [min, max, scale, numBins] (const T& x) -> GlobalIndex {
+        if (x < min || !(x < max))
+            return -1;
+        // rounding may push elements just below max into the bin behind the last one
+        return std::min((GlobalIndex)(((double)x - (double)min) * scale), numBins - 1);
+    };
+    return histogram(bin, numBins);
+}
+
+template <typename T>
+template <typename ScanFunctor>
+void VectorDistribution<T>::scanBlock(ScanFunctor& f, const T* identity, bool exclusive, T* out) const {
+    static_assert(IsReduceFunctor<ScanFunctor, T>::value, "scan: functor has to be callable as T f(T, T) const");
+    typedef ReduceIdentity<ScanFunctor, T> Identity;
+
+    if (!distribution.isContiguous())
+        throw std::invalid_argument("scan: distribution has to be contiguous");
+
+    const T known = Identity::get();
+    if (identity == nullptr && Identity::known)
+        identity = &known;
+
+    // without a neutral element the offsets of empty prefixes are empty
+    const OptionalValue<T> empty = {identity != nullptr ? *identity : T(), identity != nullptr};
+    SkipEmpty<ScanFunctor> skip{f};
+    const T* in = localData;
+    const DistributionTerminal<T> terminal(*this);
+    std::vector<PaddedValue<OptionalValue<T>>> offsets(omp_get_max_threads());
+    OptionalValue<T> processOffset = empty;
+    ProfileScope scope(exclusive ? "exscan" : "scan", PROFILE_CALL);
+
+    #pragma omp parallel
+    {
+        const int thread = omp_get_thread_num();
+        const int numThreads = omp_get_num_threads();
+
+        GlobalIndex begin, end;
+        staticRange(localSize, thread, numThreads, begin, end);
+
+        // first pass, total of every chunk
+        if (identity != nullptr)
+            offsets[thread].value = {foldRange(terminal, f, *identity, begin, end), true};
+        else if (begin < end)
+            offsets[thread].value = {foldRange(terminal, f, in[begin], begin + 1, end), true};
+        else
+            offsets[thread].value = empty;
+        #pragma omp barrier
+
+        // offsets of the chunks in thread order and of this process, MPI is only called by the master
+        #pragma omp master
+        {
+            OptionalValue<T> total = empty;
+            for (int t = 0; t < numThreads; t++) {
+                const OptionalValue<T> chunk = offsets[t].value;
+                offsets[t].value = total;
+                total = skip(total, chunk);
+            }
+            ProfileScope communication(exclusive ? "exscan" : "scan", PROFILE_COMMUNICATION);
+            if (identity != nullptr) {
+                communication.addBytes(sizeof(T), sizeof(T));
+                processOffset.value = exscanProcessResults(total.value, f, *identity, communicator.get());
+            } else {
+                communication.addBytes(sizeof(OptionalValue<T>), sizeof(OptionalValue<T>));
+                processOffset = exscanProcessResults(total, skip, empty, communicator.get());
+            }
+        }
+        #pragma omp barrier
+
+        // second pass, scan every chunk starting from its offset, or from its first element if the
+        // offset is empty (only without a neutral element, so only for the inclusive scan)
+        OptionalValue<T> offset = skip(processOffset, offsets[thread].value);
+        GlobalIndex i = begin;
+        if (!offset.valid && i < end) {
+            out[i] = in[i];
+            offset = {in[i++], true};
+        }
+        T acc = offset.value;
+        if (exclusive) {
+            for (; i < end; i++) {
+                const T value = in[i];
+                out[i] = acc;
+                acc = f(acc, value);
+            }
+        } else {
+            for (; i < end; i++) {
+                acc = f(acc, in[i]);
+                out[i] = acc;
+            }
+        }
+    }
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+T VectorDistribution<T>::reduce(ReduceFunctor &f) const {
+    return reduceExpression<T>(DistributionTerminal<T>(*this), f, false);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+T VectorDistribution<T>::reduce(ReduceFunctor &f, const T& identity) const {
+    return reduceExpression(DistributionTerminal<T>(*this), f, identity, false);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+T VectorDistribution<T>::allReduce(ReduceFunctor &f) const {
+    return reduceExpression<T>(DistributionTerminal<T>(*this), f, true);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+T VectorDistribution<T>::allReduce(ReduceFunctor &f, const T& identity) const {
+    return reduceExpression(DistributionTerminal<T>(*this), f, identity, true);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+SkeletonFuture<T> VectorDistribution<T>::reduceAsync(ReduceFunctor &f) const {
+    return reduceExpressionAsync<T>(DistributionTerminal<T>(*this), f);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+SkeletonFuture<T> VectorDistribution<T>::reduceAsync(ReduceFunctor &f, const T& identity) const {
+    return reduceExpressionAsync(DistributionTerminal<T>(*this), f, identity);
+}
+
+template <typename T>
+template <typename ReduceFunctor>
+T VectorDistribution<T>::reduce(ReducePlan<T, ReduceFunctor>& plan) const {
+    return reduceExpression(DistributionTerminal<T>(*this), plan);
+}
+
+template <typename T>
+template <typename R, typename Other, typename ZipFunctor>
+ZipExpression<R, DistributionTerminal<T>, typename ExpressionOf<Other>::type, ZipFunctor>
+VectorDistribution<T>::zip(const Other& b, ZipFunctor &f) const {
+    return ZipExpression<R, DistributionTerminal<T>, typename ExpressionOf<Other>::type, ZipFunctor>(
+            DistributionTerminal<T>(*this), ExpressionOf<Other>::get(b), f);
+}
+
+template <typename T>
+template <typename R, typename Other, typename ZipFunctor>
+void VectorDistribution<T>::zip(const Other& b, ZipFunctor &f, VectorDistribution<R>& out) const {
+    out = zip<R>(b, f);
+}
+
+template <typename T>
+template <typename R, typename Other, typename ZipFunctor>
+ZipIndexExpression<R, DistributionTerminal<T>, typename ExpressionOf<Other>::type, ZipFunctor>
+VectorDistribution<T>::zipIndex(const Other& b, ZipFunctor& f) const {
+    return ZipIndexExpression<R, DistributionTerminal<T>, typename ExpressionOf<Other>::type, ZipFunctor>(
+            DistributionTerminal<T>(*this), ExpressionOf<Other>::get(b), f);
+}
+
+template <typename T>
+template <typename R, typename Other, typename ZipFunctor>
+void VectorDistribution<T>::zipIndex(const Other& b, ZipFunctor& f, VectorDistribution<R>& out) const {
+    out = zipIndex<R>(b, f);
+}
+
+template <typename T>
+template <typename Other, typename ZipFunctor>
+void VectorDistribution<T>::zipInPlace(const Other& b, ZipFunctor &f) {
+    typename ExpressionOf<Other>::type other = ExpressionOf<Other>::get(b);
+    static_assert(IsZipFunctor<ZipFunctor, T, typename ExpressionOf<Other>::type::value_type, T>::value,
+                  "zipInPlace: functor has to be callable as T f(T, T2) const");
+
+    // elements are combined by local index, so both operands have to share the layout
+    if (distribution != other.getDistribution())
+        throw std::invalid_argument("zipInPlace: operands have different distributions");
+
+    ProfileScope scope("zipInPlace", PROFILE_CALL);
+    ThreadTimer timer;
+    T* local = localData;
+
+    #pragma omp parallel
+    {
+        timer.start();
+        #pragma omp for schedule(static) nowait
+        for (GlobalIndex i = 0; i < localSize; i++) {
+            local[i] = f(local[i], other(i));
+        }
+        timer.stop();
     }
-    return result;
 }
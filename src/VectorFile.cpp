@@ -0,0 +1,115 @@
+#include "VectorFile.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static const char VECTOR_FILE_MAGIC[8] = "SKELVEC";
+static const std::uint32_t VECTOR_FILE_VERSION = 1;
+
+VectorFileHeader makeVectorFileHeader(GlobalIndex size, std::size_t elementSize) {
+    VectorFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, VECTOR_FILE_MAGIC, sizeof(header.magic));
+    header.version = VECTOR_FILE_VERSION;
+    header.elementSize = (std::uint32_t)elementSize;
+    header.size = size;
+    header.dataOffset = sizeof(VectorFileHeader);
+    return header;
+}
+
+bool createVectorFile(const std::string& path, const VectorFileHeader& header) {
+    int fd = open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    const off_t fileSize = (off_t)(header.dataOffset + header.size * (std::int64_t)header.elementSize);
+    bool ok = ftruncate(fd, fileSize) == 0 && pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    return close(fd) == 0 && ok;
+}
+
+MPI_File openVectorFile(const std::string& path, int mode, const Communicator& communicator) {
+    MPI_File file;
+    int error = MPI_File_open(communicator.get(), path.c_str(), mode, MPI_INFO_NULL, &file);
+    // MPI_File_open is collective, so all processes see an error if one does
+    if (error != MPI_SUCCESS)
+        throw std::runtime_error("cannot open " + path);
+    return file;
+}
+
+VectorFileHeader readVectorFileHeader(const std::string& path, std::size_t elementSize,
+                                      const Communicator& communicator) {
+    VectorFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    // 0: valid, 1: unreadable, 2: no vector file, 3: other element size, 4: truncated
+    int status = 0;
+
+    if (communicator.getRank() == 0) {
+        int fd = open(path.c_str(), O_RDONLY);
+        off_t fileSize = fd >= 0 ? lseek(fd, 0, SEEK_END) : -1;
+        if (fd < 0 || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+            status = 1;
+        else if (std::memcmp(header.magic, VECTOR_FILE_MAGIC, sizeof(header.magic)) != 0
+                 || header.version != VECTOR_FILE_VERSION || header.size < 0)
+            status = 2;
+        else if (header.elementSize != elementSize)
+            status = 3;
+        else if ((std::int64_t)fileSize < header.dataOffset + header.size * (std::int64_t)elementSize)
+            status = 4;
+        if (fd >= 0)
+            close(fd);
+    }
+
+    MPI_Bcast(&status, 1, MPI_INT, 0, communicator.get());
+    switch (status) {
+        case 1:
+            throw std::runtime_error("readFile: cannot read " + path);
+        case 2:
+            throw std::runtime_error("readFile: " + path + " is no vector file");
+        case 3:
+            throw std::runtime_error("readFile: " + path + " holds elements of another size");
+        case 4:
+            throw std::runtime_error("readFile: " + path + " is truncated");
+        default:
+            break;
+    }
+
+    MPI_Bcast(&header, sizeof(header), MPI_BYTE, 0, communicator.get());
+    return header;
+}
+
+MappedFile::MappedFile(const std::string& path, std::int64_t offset, std::size_t bytes, bool writable)
+    : base(nullptr), length(0), shift(0), bytes(bytes) {
+    if (bytes == 0)
+        return;
+
+    int fd = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0)
+        return;
+
+    // mmap offsets have to be multiples of the page size
+    const std::int64_t page = sysconf(_SC_PAGESIZE);
+    const std::int64_t start = offset / page * page;
+    shift = (std::size_t)(offset - start);
+    length = shift + bytes;
+
+    void* p = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                   writable ? MAP_SHARED : MAP_PRIVATE, fd, (off_t)start);
+    close(fd);
+    if (p == MAP_FAILED)
+        return;
+
+    base = p;
+    // the block is streamed once from front to back
+    madvise(base, length, MADV_SEQUENTIAL);
+}
+
+MappedFile::~MappedFile() {
+    if (base != nullptr)
+        munmap(base, length);
+}
+
+bool MappedFile::sync() {
+    return base == nullptr || msync(base, length, MS_SYNC) == 0;
+}
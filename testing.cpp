@@ -5,6 +5,7 @@
 
 #include "functors.hpp"
 #include "VectorDistribution.hpp"
+#include "GatherPlan.hpp"
 #include "Utils.hpp"
 
 struct Add : MapFunctor<int, int> {
@@ -51,13 +52,24 @@ int main(int argc, char** argv) {
     auto intSum = [] (int val1, int val2) {return val1 + val2;};
     auto doubleSum = [] (double val1, double val2) {return val1 + val2;};
 
-    auto intReduced = intVecD.reduce(intSum);
-    auto doubleReduced = doubleVecD.reduce(doubleSum);
+    auto intReduced = intVecD.allReduce(intSum);
+    auto doubleReduced = doubleVecD.allReduce(doubleSum);
 
 
     std::cout << "intRed: " << intReduced << std::endl;
     std::cout << "doubleRed: " << doubleReduced << std::endl;
 
+    // the plan sizes the results and can be rerun after every update of the vector
+    std::vector<int> gathered;
+    {
+        GatherPlan<int> plan(intVecD, gathered);
+        Add add;
+        for (int i = 0; i < 2; i++) {
+            intVecD.mapInPlace(add);
+            plan.run();
+            printVec(gathered);
+        }
+    }
 
     terminateSkeletons();
     return 0;
@@ -0,0 +1,508 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "VectorDistribution.hpp"
+#include "DistributedMatrix.hpp"
+#include "GatherPlan.hpp"
+
+/*
+ * Behavioural checks of the skeletons, run by CTest under mpirun with several process counts. Every
+ * check gathers the result and compares it with a sequential reference; the program fails if any
+ * check fails on any process.
+ */
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& name) {
+    if (!ok) {
+        failures++;
+        std::printf("rank %d: %s failed\n", Utils::proc_rank, name.c_str());
+    }
+}
+
+// a receive of the application for any tag, pending while a skeleton runs; library messages on the
+// same communicator would be caught by it
+struct PendingReceive {
+    double value = 0;
+    MPI_Request request;
+
+    PendingReceive() { MPI_Irecv(&value, 1, MPI_DOUBLE, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &request); }
+
+    // completes the receive with a message of the right neighbor
+    bool intact() {
+        const double marker = 42.0;
+        MPI_Send(&marker, 1, MPI_DOUBLE, (Utils::proc_rank + 1) % Utils::num_procs, 1, MPI_COMM_WORLD);
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        return value == marker;
+    }
+};
+
+// weights which give rank 0 a larger block than the others
+static std::vector<double> skewedWeights() {
+    std::vector<double> weights(Utils::num_procs, 1.0);
+    weights[0] = 3.0;
+    return weights;
+}
+
+// builtin SIMD reductions only where they compute what the functor computes
+static_assert(SimdReduction<double, std::plus<double>>::sum && SimdReduction<double, std::plus<>>::sum,
+              "std::plus over the element type is a SIMD sum");
+static_assert(!SimdReduction<double, std::plus<int>>::sum && !SimdReduction<double, std::multiplies<int>>::product,
+              "functors converting their arguments are not SIMD reductions");
+
+struct Max {
+    int operator()(int a, int b) const { return a > b ? a : b; }
+};
+
+// the leftmost element with the largest residue, associative but without a neutral element
+struct LargestResidue {
+    int modulus;
+
+    int operator()(int a, int b) const { return b % modulus > a % modulus ? b : a; }
+};
+
+struct Scrambled {
+    long operator()(GlobalIndex i) const { return (long)((i * 2654435761L) % 1000003) - 500000; }
+};
+
+struct Record {
+    int key;
+    int payload;
+};
+
+struct ByKey {
+    bool operator()(const Record& a, const Record& b) const { return a.key < b.key; }
+};
+
+struct EndsInThree {
+    bool operator()(long x) const { return x % 10 == 3; }
+};
+
+struct Weighted {
+    GlobalIndex radius;
+
+    double operator()(const Neighborhood<double>& nb) const {
+        double sum = 0;
+        for (GlobalIndex k = -radius; k <= radius; k++) {
+            sum += nb[k] * (double)(k + radius + 1);
+        }
+        return sum;
+    }
+};
+
+struct Residue {
+    int operator()(long x) const { return (int)(x % 101); }
+};
+
+struct AsDouble {
+    double operator()(long x) const { return (double)x; }
+};
+
+struct Bin {
+    GlobalIndex operator()(long x) const { return x % 50 - 3; }
+};
+
+static void testReduce() {
+    for (GlobalIndex n : {0, 1, 5, 1000}) {
+        auto generator = [] (GlobalIndex i) { return -1000 + (int)(i * 7 % 13); };
+        VectorDistribution<int> v(Distribution::weightedBlock(n, skewedWeights()), generator);
+        int expected = 0;
+        for (GlobalIndex i = 0; i < n; i++) {
+            expected = i == 0 ? generator(i) : std::max(expected, generator(i));
+        }
+
+        // no neutral element is known for Max, all values are negative
+        Max max;
+        check(v.allReduce(max) == expected, "allReduce without identity");
+        check(v.reduceAsync(max).get() == expected, "reduceAsync without identity");
+        const int reduced = v.reduce(max);
+        check(Utils::proc_rank != 0 || reduced == expected, "reduce without identity");
+    }
+}
+
+static void testMapIndex() {
+    VectorDistribution<int> v(Distribution::blockCyclic(100, Utils::num_procs, 3), [] (GlobalIndex i) { return (int)i; });
+    auto scaled = [] (GlobalIndex i, int x) { return (long)i * 100 + x; };
+    auto twice = [] (int x) { return 2 * x; };
+    std::plus<long> plus;
+    long expected = 0;
+    for (long i = 0; i < 100; i++) {
+        expected += i * 100 + i;
+    }
+    check(v.mapIndex<long>(scaled).allReduce(plus) == expected, "mapIndex");
+    check(v.map<int>(twice).mapIndex<long>(scaled).allReduce(plus) == expected + 99 * 50, "fused mapIndex");
+}
+
+static void testConcurrentReductions() {
+    if (Utils::thread_level < MPI_THREAD_MULTIPLE)
+        return;
+
+    // one communicator per thread, the threads reduce with the same functor type but different state
+    const int numThreads = 4;
+    std::vector<Communicator> communicators;
+    for (int t = 0; t < numThreads; t++) {
+        communicators.push_back(Communicator().split(0, Utils::proc_rank));
+    }
+    std::vector<int> ok(numThreads, 1);
+
+    #pragma omp parallel num_threads(numThreads)
+    {
+        const int t = omp_get_thread_num();
+        const GlobalIndex n = 1000;
+        auto generator = [] (GlobalIndex i) { return (int)(i * 7919 % 10007); };
+        LargestResidue f{10 + t};
+        int expected = generator(0);
+        for (GlobalIndex i = 1; i < n; i++) {
+            expected = f(expected, generator(i));
+        }
+
+        VectorDistribution<int> v(n, generator, communicators[t]);
+        for (int round = 0; round < 20; round++) {
+            SkeletonFuture<int> pending = v.reduceAsync(f);
+            const int blocking = v.allReduce(f);
+            ok[t] &= blocking == expected && pending.get() == expected;
+        }
+    }
+    check(std::all_of(ok.begin(), ok.end(), [] (int x) { return x != 0; }), "concurrent reductions");
+}
+
+static void testScan() {
+    for (GlobalIndex n : {0, 1, 17, 1000}) {
+        auto generator = [] (GlobalIndex i) { return -1000 + (int)(i * 7 % 13); };
+        VectorDistribution<int> v(n, generator);
+        Max max;
+        std::plus<int> plus;
+        std::vector<int> running(n), sums(n), exclusive(n);
+        v.scan(max).gatherVectors(running);
+        v.scan(plus).gatherVectors(sums);
+        v.exscan(plus, 0).gatherVectors(exclusive);
+
+        if (Utils::proc_rank == 0) {
+            bool ok = true;
+            int m = 0, sum = 0;
+            for (GlobalIndex i = 0; i < n; i++) {
+                ok &= exclusive[i] == sum;
+                m = i == 0 ? generator(i) : std::max(m, generator(i));
+                sum += generator(i);
+                ok &= running[i] == m && sums[i] == sum;
+            }
+            check(ok, "scan");
+        }
+    }
+}
+
+static void testSort() {
+    const int P = Utils::num_procs;
+    for (GlobalIndex n : {0, 7, 100003}) {
+        for (const Distribution& d : {Distribution::balancedBlock(n, P), Distribution::blockCyclic(n, P, 5),
+                                      Distribution::weightedBlock(n, skewedWeights())}) {
+            Scrambled generator;
+            VectorDistribution<long> v(d, generator);
+            std::less<long> less;
+            VectorDistribution<long> sorted = v.sort(less);
+            std::vector<long> all(n), expected(n);
+            sorted.gatherVectors(all);
+            v.gatherVectors(expected);
+            std::sort(expected.begin(), expected.end());
+            check(Utils::proc_rank != 0 || all == expected, "sort");
+            check(sorted.getLocalSize() == sorted.getDistribution().localSizeOf(Utils::proc_rank), "sort layout");
+        }
+    }
+
+    // many equal keys
+    VectorDistribution<Record> records(50000, [] (GlobalIndex i) { return Record{(int)(i % 97), (int)i}; });
+    ByKey byKey;
+    records.sortInPlace(byKey);
+    std::vector<Record> all(50000);
+    records.gatherVectors(all);
+    check(Utils::proc_rank != 0 || std::is_sorted(all.begin(), all.end(), byKey), "sortInPlace");
+}
+
+static void testFilter() {
+    const int P = Utils::num_procs;
+    for (GlobalIndex n : {0, 5, 100003}) {
+        VectorDistribution<long> v(Distribution::weightedBlock(n, skewedWeights()), [] (GlobalIndex i) { return (long)i; });
+        EndsInThree pred;
+        VectorDistribution<long> kept = v.filter(pred);
+        const GlobalIndex expected = n / 10 + (n % 10 > 3 ? 1 : 0);
+        check(kept.getSize() == expected, "filter size");
+
+        bool ok = true;
+        for (GlobalIndex l = 0; l < kept.getLocalSize(); l++) {
+            ok &= kept.getLocal(l) == (long)(kept.getFirstIndex() + l) * 10 + 3;
+        }
+        check(ok, "filter");
+
+        kept.rebalance();
+        check(kept.getDistribution() == Distribution::balancedBlock(expected, P), "rebalance layout");
+        for (GlobalIndex l = 0; l < kept.getLocalSize(); l++) {
+            ok &= kept.getLocal(l) == (long)(kept.getFirstIndex() + l) * 10 + 3;
+        }
+        check(ok, "rebalance");
+    }
+}
+
+static void testStencil() {
+    const int P = Utils::num_procs;
+    auto generator = [] (GlobalIndex i) { return (double)(i * i % 17); };
+    PendingReceive pending;
+    for (GlobalIndex n : {20, 101}) {
+        for (GlobalIndex radius : {1, 2}) {
+            for (BoundaryMode mode : {PERIODIC, FIXED, CLAMPED}) {
+                if (n / P < radius)
+                    continue;
+                VectorDistribution<double> v(n, generator);
+                Weighted f{radius};
+                std::vector<double> all(n);
+                v.mapStencil<double>(radius, f, mode, -5.0).gatherVectors(all);
+
+                bool ok = true;
+                for (GlobalIndex i = 0; i < n && Utils::proc_rank == 0; i++) {
+                    double expected = 0;
+                    for (GlobalIndex k = -radius; k <= radius; k++) {
+                        const GlobalIndex j = i + k;
+                        double value;
+                        if (j >= 0 && j < n)
+                            value = generator(j);
+                        else if (mode == PERIODIC)
+                            value = generator((j + n) % n);
+                        else if (mode == FIXED)
+                            value = -5.0;
+                        else
+                            value = generator(j < 0 ? 0 : n - 1);
+                        expected += value * (double)(k + radius + 1);
+                    }
+                    ok &= all[i] == expected;
+                }
+                check(ok, "mapStencil");
+            }
+        }
+    }
+    check(pending.intact(), "mapStencil private communicator");
+}
+
+static void testReduceByKey() {
+    const int P = Utils::num_procs;
+    for (GlobalIndex n : {0, 10, 100003}) {
+        VectorDistribution<long> v(n, [] (GlobalIndex i) { return (long)i; });
+        Residue key;
+        AsDouble value;
+        std::plus<double> plus;
+        VectorDistribution<KeyValue<int, double>> groups = v.reduceByKey<int, double>(key, value, plus);
+        std::vector<KeyValue<int, double>> all(groups.getSize());
+        groups.gatherVectors(all);
+
+        bool ok = true;
+        for (GlobalIndex l = 0; l < groups.getLocalSize(); l++) {
+            ok &= hashKey(groups.getLocal(l).key) % P == (std::uint64_t)Utils::proc_rank;
+        }
+        check(ok, "reduceByKey placement");
+
+        if (Utils::proc_rank == 0) {
+            std::map<int, double> expected, got;
+            for (GlobalIndex i = 0; i < n; i++) {
+                expected[(int)(i % 101)] += (double)i;
+            }
+            for (const KeyValue<int, double>& group : all) {
+                got[group.key] = group.value;
+            }
+            check(all.size() == expected.size() && got == expected, "reduceByKey");
+        }
+    }
+}
+
+static void testHistogram() {
+    for (GlobalIndex n : {0, 100000}) {
+        VectorDistribution<long> v(n, [] (GlobalIndex i) { return (long)i; });
+        Bin bin;
+        std::vector<GlobalIndex> counts(40);
+        v.histogram(bin, 40).gatherVectors(counts);
+
+        if (Utils::proc_rank == 0) {
+            std::vector<GlobalIndex> expected(40, 0);
+            for (GlobalIndex i = 0; i < n; i++) {
+                const GlobalIndex b = i % 50 - 3;
+                if (b >= 0 && b < 40)
+                    expected[b]++;
+            }
+            check(counts == expected, "histogram");
+        }
+
+        VectorDistribution<double> d(n, [] (GlobalIndex i) { return (double)(i % 100) / 10.0; });
+        std::vector<GlobalIndex> ranges(10);
+        d.histogram(0.0, 10.0, 10).gatherVectors(ranges);
+        check(Utils::proc_rank != 0 || std::all_of(ranges.begin(), ranges.end(),
+                                                   [n] (GlobalIndex c) { return c == n / 10; }), "histogram range");
+    }
+}
+
+static void testFile() {
+    const std::string path = "skeleton-tests.bin";
+    for (FileAccess access : {COLLECTIVE_IO, MAPPED_IO}) {
+        VectorDistribution<double> v(1001, [] (GlobalIndex i) { return i * 0.5; });
+        v.writeFile(path, access);
+
+        // read into a different layout
+        VectorDistribution<double> read(Distribution::weightedBlock(1001, skewedWeights()));
+        read.readFile(path, access);
+        bool ok = read.getDistribution() == Distribution::weightedBlock(1001, skewedWeights());
+        for (GlobalIndex l = 0; l < read.getLocalSize(); l++) {
+            ok &= read.getLocal(l) == (double)(read.getFirstIndex() + l) * 0.5;
+        }
+        check(ok, "writeFile/readFile");
+    }
+
+    bool threw = false;
+    try {
+        VectorDistribution<int> wrongType;
+        wrongType.readFile(path);
+    } catch (std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "readFile element size");
+}
+
+static void testGatherStream() {
+    VectorDistribution<int> v(Distribution::blockCyclic(1001, Utils::num_procs, 7), [] (GlobalIndex i) { return (int)i; });
+    PendingReceive pending;
+    GlobalIndex next = 0;
+    bool ok = true;
+    v.gatherStream([&] (GlobalIndex first, const int* data, GlobalIndex count) {
+        ok &= first == next;
+        for (GlobalIndex k = 0; k < count; k++) {
+            ok &= data[k] == (int)(first + k);
+        }
+        next = first + count;
+    }, 5);
+    check(ok && next == (Utils::proc_rank == 0 ? 1001 : 0), "gatherStream");
+    check(pending.intact(), "gatherStream private communicator");
+}
+
+static void testRedistribute() {
+    const GlobalIndex n = 1001;
+    VectorDistribution<int> v(Distribution::weightedBlock(n, skewedWeights()), [] (GlobalIndex i) { return (int)i; });
+    PendingReceive pending;
+    v.redistribute(Distribution::balancedBlock(n, Utils::num_procs));
+    std::vector<int> all(n);
+    v.gatherVectors(all);
+    bool ok = v.getDistribution() == Distribution::balancedBlock(n, Utils::num_procs);
+    for (GlobalIndex i = 0; i < n && Utils::proc_rank == 0; i++) {
+        ok &= all[i] == (int)i;
+    }
+    check(ok, "redistribute");
+    check(pending.intact(), "redistribute private communicator");
+}
+
+static void testGatherPlan() {
+    VectorDistribution<int> v(Distribution::blockCyclic(37, Utils::num_procs, 2), [] (GlobalIndex i) { return (int)i; });
+    std::vector<int> results;
+    GatherPlan<int> plan(v, results, true);
+    bool ok = true;
+    for (int round = 0; round < 3; round++) {
+        plan.run();
+        for (int i = 0; i < 37; i++) {
+            ok &= results[i] == i + round;
+        }
+        auto increment = [] (int x) { return x + 1; };
+        v.mapInPlace(increment);
+    }
+    check(ok, "GatherPlan");
+
+    // a stale plan fails on every process, not only on the root
+    std::vector<int> rootResults;
+    GatherPlan<int> rootPlan(v, rootResults);
+    if (Utils::proc_rank == 0)
+        rootResults.assign(1, 0);
+    bool threw = false;
+    try {
+        rootPlan.run();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "GatherPlan resized results");
+}
+
+static void testMatrix() {
+    const GlobalIndex rows = 37, cols = 53;
+    for (int gridRows : {0, 1, Utils::num_procs}) {
+        MatrixLayout layout(rows, cols, Communicator(), gridRows, 8);
+        auto generator = [] (GlobalIndex i, GlobalIndex j) { return (double)(i * 1000 + j); };
+        DistributedMatrix<double> a(layout, generator);
+
+        std::vector<double> all;
+        a.gatherMatrix(all);
+        bool ok = true;
+        for (GlobalIndex i = 0; i < rows && Utils::proc_rank == 0; i++) {
+            for (GlobalIndex j = 0; j < cols; j++) {
+                ok &= all[i * cols + j] == generator(i, j);
+            }
+        }
+        check(ok, "gatherMatrix");
+
+        auto twice = [] (double x) { return 2 * x; };
+        std::plus<double> plus;
+        DistributedMatrix<double> b = a.map<double>(twice);
+        DistributedMatrix<double> sum = a.zip<double>(b, plus);
+        double expected = 0;
+        for (GlobalIndex i = 0; i < rows; i++) {
+            for (GlobalIndex j = 0; j < cols; j++) {
+                expected += 3 * generator(i, j);
+            }
+        }
+        check(sum.allReduce(plus) == expected, "matrix map/zip/allReduce");
+
+        VectorDistribution<double> rowSums = a.reduceRows(plus);
+        VectorDistribution<double> x(Distribution::weightedBlock(cols, skewedWeights()),
+                                     [] (GlobalIndex j) { return (double)(j % 7); });
+        VectorDistribution<double> y = a.multiply(x);
+        for (GlobalIndex l = 0; l < rowSums.getLocalSize(); l++) {
+            const GlobalIndex i = rowSums.getFirstIndex() + l;
+            double rowSum = 0, product = 0;
+            for (GlobalIndex j = 0; j < cols; j++) {
+                rowSum += generator(i, j);
+                product += generator(i, j) * (double)(j % 7);
+            }
+            ok &= rowSums.getLocal(l) == rowSum && y.getLocal(l) == product;
+        }
+        check(ok, "reduceRows/multiply");
+
+        std::vector<double> colMax(cols);
+        auto max = [] (double p, double q) { return p > q ? p : q; };
+        a.reduceCols(max).gatherVectors(colMax);
+        for (GlobalIndex j = 0; j < cols && Utils::proc_rank == 0; j++) {
+            ok &= colMax[j] == generator(rows - 1, j);
+        }
+        check(ok, "reduceCols");
+    }
+}
+
+int main(int argc, char** argv) {
+    initSkeletons(argc, argv, MPI_THREAD_MULTIPLE);
+
+    testReduce();
+    testMapIndex();
+    testConcurrentReductions();
+    testScan();
+    testSort();
+    testFilter();
+    testStencil();
+    testReduceByKey();
+    testHistogram();
+    testFile();
+    testGatherStream();
+    testRedistribute();
+    testGatherPlan();
+    testMatrix();
+
+    int total = 0;
+    MPI_Allreduce(&failures, &total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if (Utils::proc_rank == 0)
+        std::printf("%d failed checks\n", total);
+
+    terminateSkeletons();
+    return total == 0 ? 0 : 1;
+}